@@ -0,0 +1,202 @@
+/*
+* Batched Beam Search Step
+* BeamSearch<Score> - selects best `width` expansions of a beam step:
+*   candidate (b, v) has score beam_scores[b] + scores[b * vocab + v]
+*   score matrix is split between threads, each thread keeps a bounded
+*   TopK and skips blocks of scores below its threshold with a branchless
+*   loop (vectorized by compiler), partial selections are merged at the end
+*   all buffers and threads are created once, step() doesn't allocate
+*   after the first call with the same width
+* Candidate - score, beam row, token; equal scores prefer smaller (beam, token),
+*   so result doesn't depend on number of threads
+* Methods:
+*   1. BeamSearch(size_t width, unsigned threads = 1)
+*   2. size_t width()
+*   3. const std::vector<Candidate> &step(const Score *beam_scores,
+*          const Score *scores, size_t rows, size_t vocab)
+*       return up to width candidates, best first; the reference is valid
+*       until next step()
+*       complexity: O(rows * vocab / threads) + O(kept * lg(width))
+*   4. void set_threads(unsigned n)
+*/
+#ifndef _ALG_BEAM_SEARCH
+#define _ALG_BEAM_SEARCH
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include "TopK.hpp"
+
+namespace alg {
+    template <typename Score = float>
+    class BeamSearch {
+    public:
+        struct Candidate {
+            Score score;
+            uint32_t beam;
+            uint32_t token;
+            // a < b if a is worse
+            bool operator < (const Candidate &r) const {
+                if (score != r.score)
+                    return score < r.score;
+                if (beam != r.beam)
+                    return beam > r.beam;
+                return token > r.token;
+            }
+        };
+
+    private:
+        static constexpr size_t BLOCK = 64;
+        // below this many scores a step isn't worth waking workers
+        static constexpr size_t MIN_PARALLEL = 1 << 14;
+
+        size_t _width;
+        std::vector<TopK<Candidate>> parts;
+        std::vector<Candidate> result;
+
+        // current step, read by workers
+        const Score *beam_scores = nullptr;
+        const Score *scores = nullptr;
+        size_t rows = 0;
+        size_t vocab = 0;
+        size_t nparts = 1;
+
+        std::vector<std::thread> workers;
+        std::mutex pool_lock;
+        std::condition_variable pool_cv, done_cv;
+        uint64_t job_id = 0;
+        unsigned busy = 0;
+        bool stopping = false;
+
+        void scan_row(TopK<Candidate> &top, uint32_t b, size_t from, size_t to) {
+            const Score base = beam_scores[b];
+            const Score *row = scores + size_t(b) * vocab;
+            size_t v = from;
+            while (v < to && top.size() < _width) {
+                top.push(Candidate{base + row[v], b, uint32_t(v)});
+                v++;
+            }
+            for (; v + BLOCK <= to; v += BLOCK) {
+                // ties may still win by index, so keep scores equal to threshold
+                const Score thr = top.threshold().score;
+                unsigned any = 0;
+                for (size_t j = 0; j < BLOCK; j++)
+                    any |= unsigned(base + row[v + j] >= thr);
+                if (!any)
+                    continue;
+                for (size_t j = 0; j < BLOCK; j++)
+                    top.push(Candidate{base + row[v + j], b, uint32_t(v + j)});
+            }
+            for (; v < to; v++)
+                top.push(Candidate{base + row[v], b, uint32_t(v)});
+        }
+
+        void scan_part(size_t p) {
+            TopK<Candidate> &top = parts[p];
+            top.clear();
+            size_t total = rows * vocab;
+            size_t from = total * p / nparts;
+            size_t to = total * (p + 1) / nparts;
+            while (from < to) {
+                size_t b = from / vocab;
+                size_t end = std::min(to, (b + 1) * vocab);
+                scan_row(top, uint32_t(b), from - b * vocab, end - b * vocab);
+                from = end;
+            }
+        }
+
+        void worker_loop(size_t p) {
+            uint64_t seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> guard(pool_lock);
+                    pool_cv.wait(guard, [&] { return stopping || job_id != seen; });
+                    if (stopping)
+                        return;
+                    seen = job_id;
+                }
+                if (p < nparts)
+                    scan_part(p);
+                std::lock_guard<std::mutex> guard(pool_lock);
+                if (--busy == 0)
+                    done_cv.notify_one();
+            }
+        }
+
+        void stop_workers() {
+            {
+                std::lock_guard<std::mutex> guard(pool_lock);
+                stopping = true;
+            }
+            pool_cv.notify_all();
+            for (auto &w : workers)
+                w.join();
+            workers.clear();
+            stopping = false;
+        }
+
+    public:
+        explicit BeamSearch(size_t width, unsigned threads = 1) : _width(width) {
+            if (width == 0)
+                throw std::invalid_argument("BeamSearch width must be positive");
+            result.reserve(width);
+            set_threads(threads);
+        }
+        BeamSearch(const BeamSearch &) = delete;
+        BeamSearch &operator = (const BeamSearch &) = delete;
+        ~BeamSearch() {
+            stop_workers();
+        }
+
+        size_t width() const noexcept {
+            return _width;
+        }
+
+        void set_threads(unsigned n) {
+            stop_workers();
+            n = std::max(n, 1u);
+            parts.clear();
+            for (unsigned i = 0; i < n; i++)
+                parts.emplace_back(_width);
+            for (unsigned i = 1; i < n; i++)
+                workers.emplace_back([this, i] { worker_loop(i); });
+        }
+
+        const std::vector<Candidate> &step(const Score *beam_scores, const Score *scores,
+                                           size_t rows, size_t vocab) {
+            this->beam_scores = beam_scores;
+            this->scores = scores;
+            this->rows = rows;
+            this->vocab = vocab;
+            size_t total = rows * vocab;
+            result.clear();
+            if (total == 0)
+                return result;
+            nparts = total < MIN_PARALLEL ? 1 : parts.size();
+            if (nparts > 1) {
+                {
+                    std::lock_guard<std::mutex> guard(pool_lock);
+                    busy = unsigned(workers.size());
+                    job_id++;
+                }
+                pool_cv.notify_all();
+                scan_part(0);
+                std::unique_lock<std::mutex> guard(pool_lock);
+                done_cv.wait(guard, [&] { return busy == 0; });
+            } else {
+                scan_part(0);
+            }
+            for (size_t p = 1; p < nparts; p++)
+                parts[0].merge(parts[p]);
+            parts[0].sorted(result);
+            return result;
+        }
+    };
+}
+
+#endif // _ALG_BEAM_SEARCH
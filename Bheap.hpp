@@ -20,13 +20,24 @@
 *    6. T pop() - pop element from heap
 *       return this element to user
 *       complexity: O(lg(N))
+*    7. void save(std::ostream &out) - write heap shape and keys
+*       T must be trivially copyable, keys are written in one block
+*       complexity: O(N)
+*    8. void load(std::istream &in) - replace heap with saved one,
+*       restores exactly the same shape without consolidation, throws
+*       std::runtime_error if it isn't a valid binomial heap
+*       complexity: O(N)
 *
 */
 #ifndef _ALG_BIN_HEAP
-#define _AlG_BIN_HEAP
+#define _ALG_BIN_HEAP
 #include <memory>
 #include <exception>
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "HeapSnapshot.hpp"
 
 namespace alg {
     template <typename T> class Bheap;
@@ -52,6 +63,7 @@ namespace alg {
     template <typename T>
     class Bheap {
         using NodePtr = std::shared_ptr<BheapNode<T>>;
+        static constexpr uint32_t SNAPSHOT_MAGIC = 0x31504842; // "BHP1"
         NodePtr head;
         std::allocator<T> alloc;
         size_t _size = 0;
@@ -122,7 +134,7 @@ namespace alg {
 
             head = new_head;
         };
-        NodePtr &get_min_node() {
+        NodePtr get_min_node() {
             NodePtr x,min;
             x  = head->sibling;
             min = head;
@@ -181,11 +193,16 @@ namespace alg {
                 prev_min->sibling = min->sibling;
             }
 
-            NodePtr add_head = min->child;
-            x = add_head;
+            // children are linked in decreasing degree order,
+            // root list needs increasing one
+            NodePtr add_head, next_x;
+            x = min->child;
             while (x) {
                 x->p = nullptr;
-                x = x->sibling;
+                next_x = x->sibling;
+                x->sibling = add_head;
+                add_head = x;
+                x = next_x;
             }
             add_heap_head(add_head);
             _size--;
@@ -204,6 +221,86 @@ namespace alg {
                 z = y->p;
             }
         };
+
+        void save(std::ostream &out) const {
+            static_assert(std::is_trivially_copyable<T>::value,
+                          "Bheap::save requires trivially copyable T");
+            std::vector<uint32_t> degrees;
+            std::vector<T> keys;
+            degrees.reserve(_size);
+            keys.reserve(_size);
+            // preorder, children follow their parent in child list order
+            std::vector<BheapNode<T> *> stack;
+            for (auto r = head.get(); r; r = r->sibling.get()) {
+                stack.push_back(r);
+                while (!stack.empty()) {
+                    auto x = stack.back();
+                    stack.pop_back();
+                    degrees.push_back(uint32_t(x->degree));
+                    keys.push_back(x->key);
+                    size_t first = stack.size();
+                    for (auto c = x->child.get(); c; c = c->sibling.get())
+                        stack.push_back(c);
+                    std::reverse(stack.begin() + first, stack.end());
+                }
+            }
+            snapshot::write_header(out, SNAPSHOT_MAGIC, sizeof(T), keys.size());
+            snapshot::write(out, degrees.data(), degrees.size());
+            snapshot::write(out, keys.data(), keys.size());
+        }
+
+        void load(std::istream &in) {
+            static_assert(std::is_trivially_copyable<T>::value,
+                          "Bheap::load requires trivially copyable T");
+            uint64_t n = snapshot::read_header(in, SNAPSHOT_MAGIC, sizeof(T),
+                                               sizeof(uint32_t) + sizeof(T));
+            std::vector<uint32_t> degrees;
+            std::vector<T> keys;
+            snapshot::read_vector(in, degrees, n);
+            snapshot::read_vector(in, keys, n);
+            struct Frame {
+                NodePtr node;
+                uint32_t left;
+                NodePtr last_child;
+            };
+            // roots in increasing degree order, children of a degree k node
+            // have degrees k-1, .., 0 and keys not less than their parent
+            std::vector<Frame> stack;
+            NodePtr new_head, last_root;
+            for (size_t i = 0; i < n; i++) {
+                if (stack.empty() ? last_root && degrees[i] <= last_root->degree
+                                  : degrees[i] != stack.back().left - 1 ||
+                                    keys[i] < stack.back().node->key)
+                    throw std::runtime_error("Bheap snapshot is corrupted");
+                NodePtr x = std::allocate_shared<BheapNode<T>>(alloc);
+                x->key = keys[i];
+                x->degree = degrees[i];
+                if (stack.empty()) {
+                    if (last_root)
+                        last_root->sibling = x;
+                    else
+                        new_head = x;
+                    last_root = x;
+                } else {
+                    Frame &f = stack.back();
+                    x->p = f.node;
+                    if (f.last_child)
+                        f.last_child->sibling = x;
+                    else
+                        f.node->child = x;
+                    f.last_child = x;
+                    f.left--;
+                }
+                if (degrees[i] > 0)
+                    stack.push_back(Frame{x, degrees[i], nullptr});
+                while (!stack.empty() && stack.back().left == 0)
+                    stack.pop_back();
+            }
+            if (!stack.empty())
+                throw std::runtime_error("Bheap snapshot is corrupted");
+            head = new_head;
+            _size = n;
+        }
     };
 }
 #endif // _ALG_BIN_HEAP
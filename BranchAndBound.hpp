@@ -0,0 +1,320 @@
+/*
+* Best-first Branch and Bound with Memory-bounded Open List
+* BranchAndBound<Problem, Heap> - minimizing best-first search
+*   Heap is any heap with size/get_min/insert/pop: FibHeap (default), Bheap
+*   Problem must provide:
+*     using Node = ...;                       copyable search node
+*     double bound(const Node &n) const;      lower bound of solutions below n
+*     bool is_solution(const Node &n) const;  complete solution, its cost is bound(n)
+*     void expand(const Node &n, std::vector<Node> &children) const;
+*   expand must be deterministic and thread-safe, forgotten children are
+*   regenerated by their index
+*   When open list exceeds its budget, worst quarter of it is dropped:
+*   records of open nodes live in a pool, so the dropped ones are picked
+*   by selection over the pool and the heap is rebuilt by inserts, O(N)
+*   per trim, O(1) amortized per inserted node
+*   SMA*-style: parent remembers the forgotten children and min of their
+*   bounds, and returns to open list with that backed-up bound once it has
+*   no children left in memory
+*   With threads > 1 nodes are expanded in parallel, incumbent is shared
+* Methods:
+*   1. BranchAndBound(const Problem &p, size_t memory_bytes, unsigned threads = 1)
+*       memory_bytes limits open list (approximately, closed ancestors of
+*       open nodes are not counted), Node needn't be default constructible
+*   2. Result solve(const Node &root, double incumbent = +inf)
+*       return best solution with cost < incumbent, if any
+*   3. size_t open_limit() - max number of open nodes
+* Result - found, best node (std::optional), cost, expanded/dropped node counters
+* Exception thrown by Problem stops the search and is rethrown by solve.
+*/
+#ifndef _ALG_BRANCH_AND_BOUND
+#define _ALG_BRANCH_AND_BOUND
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include "FibHeap.h"
+
+namespace alg {
+    template <typename Problem, template <typename> class Heap = FibHeap>
+    class BranchAndBound {
+    public:
+        using Node = typename Problem::Node;
+        struct Result {
+            bool found = false;
+            std::optional<Node> best;
+            double cost = std::numeric_limits<double>::infinity();
+            size_t expanded = 0;
+            size_t dropped = 0;
+        };
+
+    private:
+        struct Record {
+            Node node;
+            double bound;
+            std::shared_ptr<Record> parent;
+            uint32_t index;  // position among parent's children
+            uint32_t depth;
+            uint32_t live = 0;  // children in memory
+            std::vector<uint32_t> forgotten;
+            double forgotten_bound = std::numeric_limits<double>::infinity();
+
+            Record(Node node, double bound, std::shared_ptr<Record> parent,
+                   uint32_t index, uint32_t depth)
+                : node(std::move(node)), bound(bound), parent(std::move(parent)), index(index), depth(depth) {
+            }
+        };
+        using RecordPtr = std::shared_ptr<Record>;
+
+        struct Entry {
+            double bound;
+            uint32_t depth;
+            uint32_t slot;  // record in pool
+            uint64_t seq;
+            // best bound first, deeper first on ties to reach solutions sooner
+            bool operator < (const Entry &r) const {
+                if (bound != r.bound)
+                    return bound < r.bound;
+                if (depth != r.depth)
+                    return depth > r.depth;
+                return seq < r.seq;
+            }
+        };
+
+        const Problem &problem;
+        size_t limit;
+        unsigned threads;
+
+        // search state, guarded by lock
+        std::mutex lock;
+        std::condition_variable cv;
+        Heap<Entry> open;
+        std::vector<std::pair<Entry, RecordPtr>> pool;  // open nodes, null record if free
+        std::vector<uint32_t> free_slots;
+        uint64_t seq = 0;
+        unsigned busy = 0;
+        bool stopped = false;
+        std::exception_ptr error;
+        Result result;
+        std::atomic<double> incumbent{0};
+
+        void push(RecordPtr rec, double bound) {
+            uint32_t slot;
+            if (!free_slots.empty()) {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            } else {
+                slot = uint32_t(pool.size());
+                pool.emplace_back();
+            }
+            Entry e{bound, rec->depth, slot, seq++};
+            pool[slot] = std::make_pair(e, std::move(rec));
+            open.insert(e);
+        }
+        RecordPtr take(uint32_t slot) {
+            free_slots.push_back(slot);
+            return std::move(pool[slot].second);
+        }
+
+        // rec has no children in memory any more
+        void finish(RecordPtr rec) {
+            for (RecordPtr p = rec->parent; p; rec = p, p = p->parent) {
+                if (--p->live > 0)
+                    return;
+                if (!p->forgotten.empty()) {
+                    double b = std::max(p->bound, p->forgotten_bound);
+                    if (b < incumbent.load()) {
+                        push(p, b);
+                        return;
+                    }
+                    p->forgotten.clear();
+                }
+            }
+        }
+
+        // drop worst quarter of open list
+        void trim() {
+            std::vector<Entry> all;
+            all.reserve(open.size());
+            for (auto &o : pool) {
+                if (o.second)
+                    all.push_back(o.first);
+            }
+            size_t keep = std::max<size_t>(limit - limit / 4, 1);
+            if (all.size() <= keep)
+                return;
+            std::nth_element(all.begin(), all.begin() + keep, all.end());
+            std::vector<RecordPtr> revived;
+            for (size_t i = keep; i < all.size(); i++) {
+                Entry &e = all[i];
+                RecordPtr &rec = pool[e.slot].second;
+                RecordPtr p = rec->parent;
+                if (!p)
+                    continue; // root can't be regenerated
+                p->forgotten.push_back(rec->index);
+                p->forgotten_bound = std::min(p->forgotten_bound, e.bound);
+                if (--p->live == 0)
+                    revived.push_back(p);
+                take(e.slot);
+                result.dropped++;
+            }
+            open = Heap<Entry>();
+            for (auto &o : pool) {
+                if (o.second)
+                    open.insert(o.first);
+            }
+            double inc = incumbent.load();
+            for (auto &p : revived) {
+                double b = std::max(p->bound, p->forgotten_bound);
+                if (b < inc) {
+                    push(p, b);
+                } else {
+                    p->forgotten.clear();
+                    finish(p);
+                }
+            }
+        }
+
+        void improve(const Node &n, double cost) {
+            // called under lock
+            if (cost < incumbent.load()) {
+                incumbent.store(cost);
+                result.found = true;
+                result.best = n;
+                result.cost = cost;
+            }
+        }
+
+        void worker() {
+            std::vector<Node> children;
+            std::vector<std::pair<Node, double>> kept;
+            std::unique_lock<std::mutex> guard(lock);
+            for (;;) {
+                while (open.size() == 0 && busy > 0 && !stopped)
+                    cv.wait(guard);
+                if (stopped || open.size() == 0)
+                    break;
+                Entry e = open.pop();
+                RecordPtr rec = take(e.slot);
+                if (e.bound >= incumbent.load()) {
+                    rec->forgotten.clear();
+                    finish(rec);
+                    continue;
+                }
+                std::vector<uint32_t> regen;
+                regen.swap(rec->forgotten);
+                rec->forgotten_bound = std::numeric_limits<double>::infinity();
+                busy++;
+                result.expanded++;
+                guard.unlock();
+
+                children.clear();
+                kept.clear();
+                std::vector<uint32_t> index;
+                try {
+                    problem.expand(rec->node, children);
+                    std::sort(regen.begin(), regen.end());
+                    for (size_t i = 0; i < children.size(); i++) {
+                        if (!regen.empty() && !std::binary_search(regen.begin(), regen.end(), uint32_t(i)))
+                            continue;
+                        // pathmax: child can't be better than backed-up parent
+                        double b = std::max(problem.bound(children[i]), e.bound);
+                        if (b >= incumbent.load())
+                            continue;
+                        if (problem.is_solution(children[i])) {
+                            std::lock_guard<std::mutex> g(lock);
+                            improve(children[i], b);
+                            continue;
+                        }
+                        kept.emplace_back(std::move(children[i]), b);
+                        index.push_back(uint32_t(i));
+                    }
+                } catch (...) {
+                    guard.lock();
+                    busy--;
+                    if (!error)
+                        error = std::current_exception();
+                    stopped = true;
+                    cv.notify_all();
+                    break;
+                }
+
+                guard.lock();
+                busy--;
+                double inc = incumbent.load();
+                for (size_t i = 0; i < kept.size(); i++) {
+                    if (kept[i].second >= inc)
+                        continue;
+                    RecordPtr c = std::make_shared<Record>(std::move(kept[i].first), kept[i].second, rec,
+                                                           index[i], rec->depth + 1);
+                    rec->live++;
+                    push(std::move(c), kept[i].second);
+                }
+                if (rec->live == 0)
+                    finish(rec);
+                if (open.size() > limit)
+                    trim();
+                cv.notify_all();
+            }
+            cv.notify_all();
+        }
+
+    public:
+        BranchAndBound(const Problem &p, size_t memory_bytes, unsigned threads = 1)
+            : problem(p), threads(std::max(threads, 1u)) {
+            // record plus heap node overhead
+            limit = std::max<size_t>(memory_bytes / (sizeof(Record) + 2 * sizeof(Entry) +
+                                                     sizeof(RecordPtr) + 64), 4);
+        }
+
+        size_t open_limit() const noexcept {
+            return limit;
+        }
+
+        Result solve(const Node &root,
+                     double bound = std::numeric_limits<double>::infinity()) {
+            open = Heap<Entry>();
+            pool.clear();
+            free_slots.clear();
+            seq = 0;
+            busy = 0;
+            stopped = false;
+            error = nullptr;
+            result = Result();
+            incumbent.store(bound);
+
+            double b = problem.bound(root);
+            if (b >= bound)
+                return result;
+            if (problem.is_solution(root)) {
+                improve(root, b);
+                return result;
+            }
+            push(std::make_shared<Record>(root, b, nullptr, 0, 0), b);
+
+            std::vector<std::thread> pool;
+            for (unsigned i = 1; i < threads; i++)
+                pool.emplace_back([this] { worker(); });
+            worker();
+            for (auto &t : pool)
+                t.join();
+            open = Heap<Entry>();
+            pool.clear();
+            free_slots.clear();
+            if (error)
+                std::rethrow_exception(error);
+            return result;
+        }
+    };
+}
+
+#endif // _ALG_BRANCH_AND_BOUND
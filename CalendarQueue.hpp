@@ -0,0 +1,259 @@
+/*
+* Calendar Queue Implementation (R. Brown, 1988)
+* CalendarKey<T> - maps key to bucket time, default is double(key)
+*   specialize it or pass own functor for event structs
+* CalendarQueue<T, Key> - priority queue for discrete event simulation
+*   keys are hashed to buckets of width W by time, buckets are kept sorted,
+*   equal times in FIFO order; insert searches a bucket from its tail, so
+*   bursts of equal or increasing times are O(1) per element
+*   number of buckets and W are re-estimated when size doubles/halves
+* CalendarQueue<T>::Handle - returned by insert, required only for erase
+* Methods:
+*   1. size_t size() - return queue size
+*   2. const T &get_min() - return min element, doesn't pop it
+*       complexity: O(1) average
+*   3. Handle insert(const T &d) - insert new element to queue
+*       complexity: O(1) average
+*   4. T pop() - pop element from queue
+*       complexity: O(1) average
+*   5. bool erase(const Handle &h) - remove element from queue
+*       return false if element was already popped or erased
+*       complexity: O(1)
+* Average complexity holds while bucket width matches event spacing,
+* which is what resize keeps track of. Worst case is O(N).
+*/
+#ifndef _ALG_CALENDAR_QUEUE
+#define _ALG_CALENDAR_QUEUE
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T>
+    struct CalendarKey {
+        double operator()(const T &d) const {
+            return double(d);
+        }
+    };
+
+    template <typename T, typename Key = CalendarKey<T>>
+    class CalendarQueue {
+        static constexpr uint32_t NIL = UINT32_MAX;
+        static constexpr size_t MIN_BUCKETS = 2;
+        static constexpr size_t SAMPLE = 25;
+
+        struct Node {
+            double time;
+            uint32_t prev;
+            uint32_t next;
+            uint32_t bucket;
+            uint32_t gen = 0;
+            bool used = false;
+            T key;
+        };
+
+        Key key_of;
+        std::vector<Node> nodes;
+        std::vector<uint32_t> free_nodes;
+        std::vector<uint32_t> buckets;
+        std::vector<uint32_t> tails;
+        double width = 1.0;
+        int64_t cur = 0; // no element lives in virtual bucket < cur
+        size_t _size = 0;
+        bool resize_enabled = true;
+
+        int64_t vbucket(double time) const {
+            double v = std::floor(time / width);
+            if (v < double(INT64_MIN / 2))
+                return INT64_MIN / 2;
+            if (v > double(INT64_MAX / 2))
+                return INT64_MAX / 2;
+            return int64_t(v);
+        }
+        uint32_t bucket_of(int64_t vb) const {
+            return uint32_t(uint64_t(vb) & (buckets.size() - 1));
+        }
+
+        void link(uint32_t x) {
+            Node &n = nodes[x];
+            int64_t vb = vbucket(n.time);
+            n.bucket = bucket_of(vb);
+            // keep bucket sorted, equal keys in FIFO order; search from the
+            // tail, so equal or increasing times are appended in O(1)
+            uint32_t prev = tails[n.bucket];
+            while (prev != NIL && n.time < nodes[prev].time)
+                prev = nodes[prev].prev;
+            uint32_t y = prev != NIL ? nodes[prev].next : buckets[n.bucket];
+            n.prev = prev;
+            n.next = y;
+            if (prev != NIL)
+                nodes[prev].next = x;
+            else
+                buckets[n.bucket] = x;
+            if (y != NIL)
+                nodes[y].prev = x;
+            else
+                tails[n.bucket] = x;
+            if (vb < cur)
+                cur = vb;
+        }
+        void unlink(uint32_t x) {
+            Node &n = nodes[x];
+            if (n.prev != NIL)
+                nodes[n.prev].next = n.next;
+            else
+                buckets[n.bucket] = n.next;
+            if (n.next != NIL)
+                nodes[n.next].prev = n.prev;
+            else
+                tails[n.bucket] = n.prev;
+        }
+
+        uint32_t find_min() {
+            size_t nb = buckets.size();
+            for (size_t i = 0; i < nb; i++, cur++) {
+                uint32_t x = buckets[bucket_of(cur)];
+                if (x != NIL && vbucket(nodes[x].time) == cur)
+                    return x;
+            }
+            // a whole year without events: direct search
+            uint32_t min = NIL;
+            for (auto x : buckets) {
+                if (x != NIL && (min == NIL || nodes[x].time < nodes[min].time))
+                    min = x;
+            }
+            cur = vbucket(nodes[min].time);
+            return min;
+        }
+
+        double estimate_width() {
+            std::vector<double> times;
+            times.reserve(_size);
+            for (auto x : buckets) {
+                for (; x != NIL; x = nodes[x].next)
+                    times.push_back(nodes[x].time);
+            }
+            size_t n = std::min(times.size(), SAMPLE);
+            if (n < 2)
+                return width;
+            std::partial_sort(times.begin(), times.begin() + n, times.end());
+            double avg = (times[n - 1] - times[0]) / double(n - 1);
+            // drop outliers and recompute
+            double sum = 0;
+            size_t cnt = 0;
+            for (size_t i = 1; i < n; i++) {
+                double gap = times[i] - times[i - 1];
+                if (gap <= 2 * avg) {
+                    sum += gap;
+                    cnt++;
+                }
+            }
+            if (cnt == 0 || sum <= 0)
+                return width;
+            return 3.0 * sum / double(cnt);
+        }
+
+        void resize(size_t new_buckets) {
+            double new_width = estimate_width();
+            std::vector<uint32_t> old;
+            old.swap(buckets);
+            buckets.assign(new_buckets, NIL);
+            tails.assign(new_buckets, NIL);
+            width = new_width;
+            cur = INT64_MAX / 2;
+            for (auto x : old) {
+                while (x != NIL) {
+                    uint32_t next = nodes[x].next;
+                    link(x);
+                    x = next;
+                }
+            }
+            if (_size == 0)
+                cur = 0;
+        }
+
+        void remove(uint32_t x) {
+            unlink(x);
+            nodes[x].used = false;
+            nodes[x].gen++;
+            free_nodes.push_back(x);
+            _size--;
+            if (resize_enabled && buckets.size() > MIN_BUCKETS
+                && _size < buckets.size() / 2)
+                resize(buckets.size() / 2);
+        }
+
+    public:
+        struct Handle {
+            uint32_t idx = NIL;
+            uint32_t gen = 0;
+        };
+
+        explicit CalendarQueue(double bucket_width = 1.0, Key k = Key())
+            : key_of(k), buckets(MIN_BUCKETS, NIL), tails(MIN_BUCKETS, NIL), width(bucket_width) {
+            if (!(bucket_width > 0))
+                throw std::invalid_argument("CalendarQueue bucket width must be positive");
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+        double bucket_width() const noexcept {
+            return width;
+        }
+        // disable adaptive resizing, e.g. when bucket width is known upfront
+        void set_resize(bool enabled) noexcept {
+            resize_enabled = enabled;
+        }
+
+        const T &get_min() {
+            if (_size < 1)
+                throw std::out_of_range("get_min from empty CalendarQueue");
+            return nodes[find_min()].key;
+        }
+
+        Handle insert(const T &d) {
+            uint32_t x;
+            if (!free_nodes.empty()) {
+                x = free_nodes.back();
+                free_nodes.pop_back();
+            } else {
+                x = uint32_t(nodes.size());
+                nodes.emplace_back();
+            }
+            Node &n = nodes[x];
+            n.key = d;
+            n.time = key_of(d);
+            n.used = true;
+            if (_size == 0)
+                cur = vbucket(n.time);
+            link(x);
+            _size++;
+            if (resize_enabled && _size > 2 * buckets.size())
+                resize(buckets.size() * 2);
+            return Handle{x, nodes[x].gen};
+        }
+
+        T pop() {
+            if (_size < 1)
+                throw std::out_of_range("Pop from empty CalendarQueue");
+            uint32_t x = find_min();
+            T res = std::move(nodes[x].key);
+            remove(x);
+            return res;
+        }
+
+        bool erase(const Handle &h) {
+            if (h.idx >= nodes.size() || !nodes[h.idx].used
+                || nodes[h.idx].gen != h.gen)
+                return false;
+            remove(h.idx);
+            return true;
+        }
+    };
+}
+
+#endif // _ALG_CALENDAR_QUEUE
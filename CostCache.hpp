@@ -0,0 +1,180 @@
+/*
+* Cost-aware Cache with GreedyDual Eviction
+* CostCache<Key, Value, Policy, Hash> - cache limited by total entry size,
+*   evicts entry with the smallest priority H, then sets global inflation
+*   L = H of the evicted entry; hit or insert gives an entry
+*   H = L + Policy::credit(freq, cost, size), so priorities of other
+*   entries never need rewriting
+*   entries are kept in an addressable MinMaxHeap, ties evict least
+*   recently used entry first
+* Policies:
+*   GreedyDualSize - credit = cost / size
+*   LfuAging       - credit = freq (LFU with dynamic aging)
+*   GreedyDualSizeFreq - credit = freq * cost / size
+* Methods:
+*   1. CostCache(size_t capacity) - capacity in units of entry size
+*   2. size_t size(), size_t used(), size_t capacity(), double inflation()
+*   3. Value *get(const Key &k) - nullptr on miss, hit raises priority
+*       complexity: O(1) + O(lg(N))
+*   4. void put(const Key &k, const Value &v, size_t size = 1, double cost = 1)
+*       insert or overwrite, evicts until entry fits; entry larger than
+*       capacity is not cached
+*       complexity: O(lg(N)) per evicted entry
+*   5. bool erase(const Key &k)
+*   6. bool contains(const Key &k) - doesn't touch priority
+*/
+#ifndef _ALG_COST_CACHE
+#define _ALG_COST_CACHE
+
+#include <cstdint>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
+#include "MinMaxHeap.hpp"
+
+namespace alg {
+    struct GreedyDualSize {
+        static double credit(uint64_t, double cost, size_t size) {
+            return cost / double(size);
+        }
+    };
+    struct LfuAging {
+        static double credit(uint64_t freq, double, size_t) {
+            return double(freq);
+        }
+    };
+    struct GreedyDualSizeFreq {
+        static double credit(uint64_t freq, double cost, size_t size) {
+            return double(freq) * cost / double(size);
+        }
+    };
+
+    template <typename Key, typename Value, typename Policy = GreedyDualSize,
+              typename Hash = std::hash<Key>>
+    class CostCache {
+        struct Priority {
+            double h;
+            uint64_t tick;  // last access, older goes first on ties
+            uint32_t slot;
+            bool operator < (const Priority &r) const {
+                return h < r.h || (h == r.h && tick < r.tick);
+            }
+        };
+        using Heap = MinMaxHeap<Priority>;
+
+        struct Entry {
+            Key key;
+            std::optional<Value> value;     // empty while the slot is free
+            size_t size;
+            double cost;
+            uint64_t freq;
+            typename Heap::Handle handle;
+        };
+
+        size_t _capacity;
+        size_t _used = 0;
+        double L = 0;
+        uint64_t tick = 0;
+        Heap heap;
+        std::vector<Entry> slots;
+        std::vector<uint32_t> free_slots;
+        std::unordered_map<Key, uint32_t, Hash> index;
+
+        Priority priority(uint32_t x) {
+            const Entry &e = slots[x];
+            return Priority{L + Policy::credit(e.freq, e.cost, e.size), tick++, x};
+        }
+
+        void remove(uint32_t x) {
+            Entry &e = slots[x];
+            heap.erase(e.handle);
+            index.erase(e.key);
+            _used -= e.size;
+            e.value.reset();
+            free_slots.push_back(x);
+        }
+
+        void evict() {
+            Priority p = heap.get_min();
+            L = p.h;
+            remove(p.slot);
+        }
+
+    public:
+        explicit CostCache(size_t capacity) : _capacity(capacity) {
+            if (capacity == 0)
+                throw std::invalid_argument("CostCache capacity must be positive");
+        }
+
+        size_t size() const noexcept {
+            return index.size();
+        }
+        size_t used() const noexcept {
+            return _used;
+        }
+        size_t capacity() const noexcept {
+            return _capacity;
+        }
+        double inflation() const noexcept {
+            return L;
+        }
+
+        bool contains(const Key &k) const {
+            return index.count(k) != 0;
+        }
+
+        Value *get(const Key &k) {
+            auto it = index.find(k);
+            if (it == index.end())
+                return nullptr;
+            uint32_t x = it->second;
+            slots[x].freq++;
+            heap.update(slots[x].handle, priority(x));
+            return &*slots[x].value;
+        }
+
+        void put(const Key &k, const Value &v, size_t size = 1, double cost = 1) {
+            if (size == 0)
+                throw std::invalid_argument("CostCache entry size must be positive");
+            uint64_t freq = 1;
+            auto it = index.find(k);
+            if (it != index.end()) {
+                freq = slots[it->second].freq + 1;
+                remove(it->second);
+            }
+            if (size > _capacity)
+                return;
+            while (_used + size > _capacity)
+                evict();
+            uint32_t x;
+            if (!free_slots.empty()) {
+                x = free_slots.back();
+                free_slots.pop_back();
+                slots[x].key = k;
+                slots[x].value.emplace(v);
+            } else {
+                x = uint32_t(slots.size());
+                slots.push_back(Entry{k, v, 0, 0, 0, {}});
+            }
+            Entry &e = slots[x];
+            e.size = size;
+            e.cost = cost;
+            e.freq = freq;
+            e.handle = heap.insert(priority(x));
+            index.emplace(k, x);
+            _used += size;
+        }
+
+        bool erase(const Key &k) {
+            auto it = index.find(k);
+            if (it == index.end())
+                return false;
+            remove(it->second);
+            return true;
+        }
+    };
+}
+
+#endif // _ALG_COST_CACHE
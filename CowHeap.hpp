@@ -0,0 +1,195 @@
+/*
+* Copy-on-write Arena and Heap
+* CowArena<T, CHUNK_BITS> - growable array stored in fixed chunks of
+*   2^CHUNK_BITS elements, chunks are shared between forks by refcount
+*   and copied on first write, so fork() is O(N / 2^CHUNK_BITS)
+* Methods:
+*   1. size_t size()
+*   2. const T &operator[](size_t i) - read, never copies
+*   3. T &mut(size_t i) - write access, copies chunk if it is shared
+*       complexity: O(1), O(2^CHUNK_BITS) for the first write after fork
+*   4. void push_back(const T &d), void pop_back()
+*   5. CowArena fork() - copy sharing all chunks
+* CowHeap<T, Compare, CHUNK_BITS> - array binary min heap on CowArena,
+*   after fork() both heaps change independently and each mutation copies
+*   only chunks on its sift path
+* Methods:
+*   1. size_t size(), bool empty()
+*   2. const T &get_min() - return min element, doesn't pop it
+*       complexity: O(1)
+*   3. void insert(const T &d) - insert new element to heap
+*       complexity: O(lg(N))
+*   4. T pop() - pop element from heap
+*       complexity: O(lg(N))
+*   5. CowHeap fork() - independent copy
+*       complexity: O(N / 2^CHUNK_BITS)
+* Plain copy construction is the same as fork().
+* Forks may be used from different threads, each object by one thread
+* at a time: chunk refcounts are released with release order and checked
+* with acquire order before a write in place, so a fork's reads of a
+* chunk happen before another fork that became its only owner writes it.
+*/
+#ifndef _ALG_COW_HEAP
+#define _ALG_COW_HEAP
+
+#include <cstddef>
+#include <atomic>
+#include <utility>
+#include <vector>
+#include <array>
+#include <functional>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T, size_t CHUNK_BITS = 10>
+    class CowArena {
+        static constexpr size_t CHUNK = size_t(1) << CHUNK_BITS;
+        static constexpr size_t MASK = CHUNK - 1;
+        using Chunk = std::array<T, CHUNK>;
+
+        struct Shared {
+            std::atomic<size_t> refs{1};
+            Chunk data{};
+            Shared() = default;
+            explicit Shared(const Chunk &d) : data(d) {}
+        };
+        // shared_ptr::use_count() is a relaxed load, it doesn't order a
+        // write after the last read of a fork that dropped the chunk
+        class Ref {
+            Shared *p = nullptr;
+            void release() noexcept {
+                if (p && p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    delete p;
+            }
+        public:
+            Ref() = default;
+            explicit Ref(Shared *s) noexcept : p(s) {}
+            Ref(const Ref &r) noexcept : p(r.p) {
+                if (p)
+                    p->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+            Ref(Ref &&r) noexcept : p(r.p) {
+                r.p = nullptr;
+            }
+            Ref &operator = (Ref r) noexcept {
+                std::swap(p, r.p);
+                return *this;
+            }
+            ~Ref() {
+                release();
+            }
+            Chunk &operator * () const noexcept {
+                return p->data;
+            }
+            bool unique() const noexcept {
+                return p->refs.load(std::memory_order_acquire) == 1;
+            }
+        };
+
+        std::vector<Ref> chunks;
+        size_t _size = 0;
+
+    public:
+        size_t size() const noexcept {
+            return _size;
+        }
+
+        const T &operator[](size_t i) const noexcept {
+            return (*chunks[i >> CHUNK_BITS])[i & MASK];
+        }
+
+        T &mut(size_t i) {
+            Ref &c = chunks[i >> CHUNK_BITS];
+            // the only owner can't lose ownership to another fork
+            if (!c.unique())
+                c = Ref(new Shared(*c));
+            return (*c)[i & MASK];
+        }
+
+        void push_back(const T &d) {
+            if ((_size >> CHUNK_BITS) == chunks.size())
+                chunks.push_back(Ref(new Shared()));
+            mut(_size) = d;
+            _size++;
+        }
+        void pop_back() {
+            _size--;
+            // keep one spare chunk so push/pop at a boundary don't thrash
+            size_t need = (_size + MASK) >> CHUNK_BITS;
+            if (chunks.size() > need + 1)
+                chunks.pop_back();
+        }
+
+        CowArena fork() const {
+            return *this;
+        }
+    };
+
+    template <typename T, typename Compare = std::less<T>, size_t CHUNK_BITS = 10>
+    class CowHeap {
+        CowArena<T, CHUNK_BITS> a;
+        Compare comp;
+
+    public:
+        explicit CowHeap(Compare c = Compare()) : comp(c) {
+        }
+
+        size_t size() const noexcept {
+            return a.size();
+        }
+        bool empty() const noexcept {
+            return a.size() == 0;
+        }
+
+        const T &get_min() const {
+            if (empty())
+                throw std::out_of_range("get_min from empty CowHeap");
+            return a[0];
+        }
+
+        void insert(const T &d) {
+            size_t i = a.size();
+            a.push_back(d);
+            while (i > 0) {
+                size_t p = (i - 1) / 2;
+                if (!comp(d, a[p]))
+                    break;
+                a.mut(i) = a[p];
+                i = p;
+            }
+            if (i != a.size() - 1)
+                a.mut(i) = d;
+        }
+
+        T pop() {
+            if (empty())
+                throw std::out_of_range("Pop from empty CowHeap");
+            T res = a[0];
+            T last = a[a.size() - 1];
+            a.pop_back();
+            size_t n = a.size();
+            if (n == 0)
+                return res;
+            size_t i = 0;
+            for (;;) {
+                size_t c = 2 * i + 1;
+                if (c >= n)
+                    break;
+                if (c + 1 < n && comp(a[c + 1], a[c]))
+                    c++;
+                if (!comp(a[c], last))
+                    break;
+                a.mut(i) = a[c];
+                i = c;
+            }
+            a.mut(i) = last;
+            return res;
+        }
+
+        CowHeap fork() const {
+            return *this;
+        }
+    };
+}
+
+#endif // _ALG_COW_HEAP
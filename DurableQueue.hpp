@@ -0,0 +1,467 @@
+/*
+* Write-ahead-logged Durable Job Queue
+* DurableQueue<T> - job priority queue, in-memory FibHeap backed by a
+*   write-ahead log and periodic snapshots in a directory
+*   T must be trivially copyable and comparable with <
+*   every change is applied in memory and appended to the log buffer, log
+*   is written and fdatasync'ed by commit(); concurrent committers share
+*   one fdatasync (group commit)
+* DurableQueue<T>::JobId - id of job, stays the same after recovery
+* Methods:
+*   1. DurableQueue(const std::string &dir, size_t group_size = 4096)
+*       recover snapshot and log from dir (created if missing);
+*       commit() is called automatically every group_size changes, if it
+*       fails the change still returns its result, the error is reported
+*       by the next commit()
+*   2. size_t size() - number of jobs
+*   3. std::pair<JobId, T> get_min() - job with min key, doesn't pop it
+*   4. JobId insert(const T &key) - add job
+*   5. std::pair<JobId, T> pop() - pop job with min key
+*   6. void decrease_key(JobId id, const T &new_key)
+*   7. bool erase(JobId id) - remove job, return false for unknown id
+*   8. void commit() - make all preceding changes durable
+*   9. void checkpoint() - write snapshot and truncate the log
+*   All operations but commit/checkpoint are O(1)/FibHeap complexity,
+*   safe to call from several threads.
+* Recovery stops at the first torn or corrupted log record.
+* I/O errors are reported with std::runtime_error. A failed log write is
+* cut off the log and its records stay pending for the next commit(); a
+* failed fdatasync can't be retried, so every change and commit() throws
+* until checkpoint() writes all jobs to a new snapshot.
+*/
+#ifndef _ALG_DURABLE_QUEUE
+#define _ALG_DURABLE_QUEUE
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "FibHeap.h"
+
+namespace alg {
+    template <typename T>
+    class DurableQueue {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "DurableQueue requires trivially copyable T");
+    public:
+        using JobId = uint64_t;
+
+    private:
+        enum Op : uint8_t {
+            OP_INSERT = 1,
+            OP_POP = 2,
+            OP_DECREASE = 3,
+            OP_ERASE = 4
+        };
+        static constexpr uint32_t SNAPSHOT_MAGIC = 0x31514a44; // "DJQ1"
+        // crc, op, lsn, id, key
+        static constexpr size_t RECORD_SIZE = 4 + 1 + 8 + 8 + sizeof(T);
+
+        struct Entry {
+            T key;
+            JobId id;
+            bool operator < (const Entry &r) const {
+                return key < r.key || (!(r.key < key) && id < r.id);
+            }
+        };
+        using NodePtr = std::shared_ptr<FibHeapNode<Entry>>;
+
+        std::string dir;
+        size_t group_size;
+        int log_fd = -1;
+        off_t log_end = 0;      // end of written log records
+        bool failed = false;    // log state on disk is unknown
+        FibHeap<Entry> heap;
+        std::unordered_map<JobId, NodePtr> jobs;
+        JobId next_id = 1;
+        uint64_t next_lsn = 1;
+        uint64_t durable_lsn = 0;
+        std::vector<char> pending;
+        size_t pending_records = 0;
+        bool syncing = false;
+        std::mutex lock;
+        std::condition_variable synced;
+
+        static uint32_t crc32(const char *data, size_t n) {
+            static const auto table = [] {
+                std::vector<uint32_t> t(256);
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; k++)
+                        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                    t[i] = c;
+                }
+                return t;
+            }();
+            uint32_t c = 0xffffffffu;
+            for (size_t i = 0; i < n; i++)
+                c = table[(c ^ uint8_t(data[i])) & 0xff] ^ (c >> 8);
+            return c ^ 0xffffffffu;
+        }
+
+        static void write_all(int fd, const char *data, size_t n) {
+            while (n > 0) {
+                ssize_t w = ::write(fd, data, n);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w < 0)
+                    throw std::runtime_error("DurableQueue write failed");
+                data += w;
+                n -= size_t(w);
+            }
+        }
+        static void sync_dir(const std::string &path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd >= 0) {
+                fsync(fd);
+                ::close(fd);
+            }
+        }
+        std::string log_path() const {
+            return dir + "/wal.log";
+        }
+        std::string snapshot_path() const {
+            return dir + "/snapshot.bin";
+        }
+
+        // called under lock
+        void log(Op op, JobId id, const T &key) {
+            size_t off = pending.size();
+            pending.resize(off + RECORD_SIZE);
+            char *r = pending.data() + off;
+            uint64_t lsn = next_lsn++;
+            r[4] = char(op);
+            std::memcpy(r + 5, &lsn, 8);
+            std::memcpy(r + 13, &id, 8);
+            std::memcpy(r + 21, &key, sizeof(T));
+            uint32_t crc = crc32(r + 4, RECORD_SIZE - 4);
+            std::memcpy(r, &crc, 4);
+            pending_records++;
+        }
+
+        // in-memory changes, also used by recovery
+        void apply_insert(JobId id, const T &key) {
+            jobs[id] = heap.insert(Entry{key, id});
+            if (id >= next_id)
+                next_id = id + 1;
+        }
+        void apply_remove(JobId id) {
+            auto it = jobs.find(id);
+            if (it == jobs.end())
+                return;
+            heap.erase(it->second);
+            jobs.erase(it);
+        }
+        void apply_decrease(JobId id, const T &key) {
+            auto it = jobs.find(id);
+            if (it != jobs.end())
+                heap.decrease_key(it->second, Entry{key, id});
+        }
+
+        void load_snapshot() {
+            int fd = ::open(snapshot_path().c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            std::vector<char> buf;
+            char chunk[1 << 16];
+            ssize_t n;
+            while ((n = ::read(fd, chunk, sizeof(chunk))) > 0)
+                buf.insert(buf.end(), chunk, chunk + n);
+            ::close(fd);
+            // magic, key size, lsn, next id, count, (id, key)*, crc
+            const size_t head = 4 + 4 + 8 + 8 + 8;
+            uint32_t magic, key_size, crc;
+            uint64_t lsn, count;
+            if (n < 0 || buf.size() < head + 4)
+                throw std::runtime_error("DurableQueue snapshot is corrupted");
+            std::memcpy(&magic, buf.data(), 4);
+            std::memcpy(&key_size, buf.data() + 4, 4);
+            std::memcpy(&lsn, buf.data() + 8, 8);
+            std::memcpy(&next_id, buf.data() + 16, 8);
+            std::memcpy(&count, buf.data() + 24, 8);
+            size_t rec = 8 + sizeof(T);
+            if (magic != SNAPSHOT_MAGIC || key_size != sizeof(T)
+                || buf.size() != head + count * rec + 4)
+                throw std::runtime_error("DurableQueue snapshot is corrupted");
+            std::memcpy(&crc, buf.data() + buf.size() - 4, 4);
+            if (crc != crc32(buf.data(), buf.size() - 4))
+                throw std::runtime_error("DurableQueue snapshot is corrupted");
+            for (uint64_t i = 0; i < count; i++) {
+                JobId id;
+                T key;
+                std::memcpy(&id, buf.data() + head + i * rec, 8);
+                std::memcpy(&key, buf.data() + head + i * rec + 8, sizeof(T));
+                apply_insert(id, key);
+            }
+            next_lsn = lsn + 1;
+            durable_lsn = lsn;
+        }
+
+        void replay_log() {
+            log_fd = ::open(log_path().c_str(), O_RDWR | O_CREAT, 0644);
+            if (log_fd < 0)
+                throw std::runtime_error("DurableQueue can't open " + log_path());
+            std::vector<char> buf;
+            char chunk[1 << 16];
+            ssize_t n;
+            while ((n = ::read(log_fd, chunk, sizeof(chunk))) > 0)
+                buf.insert(buf.end(), chunk, chunk + n);
+            if (n < 0)
+                throw std::runtime_error("DurableQueue can't read " + log_path());
+            size_t valid = 0;
+            for (; valid + RECORD_SIZE <= buf.size(); valid += RECORD_SIZE) {
+                const char *r = buf.data() + valid;
+                uint32_t crc;
+                std::memcpy(&crc, r, 4);
+                if (crc != crc32(r + 4, RECORD_SIZE - 4))
+                    break;
+                Op op = Op(r[4]);
+                uint64_t lsn;
+                JobId id;
+                T key;
+                std::memcpy(&lsn, r + 5, 8);
+                std::memcpy(&id, r + 13, 8);
+                std::memcpy(&key, r + 21, sizeof(T));
+                if (lsn < next_lsn)
+                    continue; // already in snapshot
+                if (lsn != next_lsn)
+                    break;
+                switch (op) {
+                case OP_INSERT:
+                    apply_insert(id, key);
+                    break;
+                case OP_DECREASE:
+                    apply_decrease(id, key);
+                    break;
+                case OP_POP:
+                case OP_ERASE:
+                    apply_remove(id);
+                    break;
+                default:
+                    break;
+                }
+                next_lsn = lsn + 1;
+            }
+            // drop torn tail, new records are appended after valid ones
+            if (valid != buf.size() && ftruncate(log_fd, off_t(valid)) != 0)
+                throw std::runtime_error("DurableQueue can't truncate " + log_path());
+            if (lseek(log_fd, off_t(valid), SEEK_SET) < 0)
+                throw std::runtime_error("DurableQueue can't seek " + log_path());
+            log_end = off_t(valid);
+            durable_lsn = next_lsn - 1;
+        }
+
+        // called with lock held
+        void check_failed() const {
+            if (failed)
+                throw std::runtime_error("DurableQueue log failed, checkpoint() to recover");
+        }
+
+        // called with lock held
+        void commit_locked(std::unique_lock<std::mutex> &guard) {
+            uint64_t target = next_lsn - 1;
+            while (durable_lsn < target) {
+                check_failed();
+                if (syncing) {
+                    synced.wait(guard);
+                    continue;
+                }
+                // become leader, flush everything pending so far
+                syncing = true;
+                std::vector<char> buf;
+                buf.swap(pending);
+                pending_records = 0;
+                uint64_t upto = next_lsn - 1;
+                guard.unlock();
+                bool written = false;
+                try {
+                    write_all(log_fd, buf.data(), buf.size());
+                    written = true;
+                    if (fdatasync(log_fd) != 0)
+                        throw std::runtime_error("DurableQueue fdatasync failed");
+                } catch (...) {
+                    // cut the partial write, records go back in front of
+                    // the ones logged meanwhile
+                    bool cut = !written && ftruncate(log_fd, log_end) == 0
+                               && lseek(log_fd, log_end, SEEK_SET) >= 0;
+                    guard.lock();
+                    if (cut) {
+                        buf.insert(buf.end(), pending.begin(), pending.end());
+                        pending.swap(buf);
+                        pending_records = pending.size() / RECORD_SIZE;
+                    } else {
+                        failed = true;
+                    }
+                    syncing = false;
+                    synced.notify_all();
+                    throw;
+                }
+                guard.lock();
+                log_end += off_t(buf.size());
+                syncing = false;
+                if (upto > durable_lsn)
+                    durable_lsn = upto;
+                synced.notify_all();
+            }
+        }
+
+        // the change is already applied and logged, so a failed group
+        // commit must not hide its result: records stay pending or the
+        // queue is marked failed, commit() or the next change reports it
+        void maybe_commit(std::unique_lock<std::mutex> &guard) {
+            if (pending_records < group_size)
+                return;
+            try {
+                commit_locked(guard);
+            } catch (const std::runtime_error &) {
+            }
+        }
+
+    public:
+        explicit DurableQueue(const std::string &path, size_t group_size = 4096)
+            : dir(path), group_size(group_size ? group_size : 1) {
+            mkdir(dir.c_str(), 0755);
+            load_snapshot();
+            replay_log();
+        }
+        DurableQueue(const DurableQueue &) = delete;
+        DurableQueue &operator = (const DurableQueue &) = delete;
+        ~DurableQueue() {
+            try {
+                commit();
+            } catch (...) {
+            }
+            if (log_fd >= 0)
+                ::close(log_fd);
+        }
+
+        size_t size() {
+            std::lock_guard<std::mutex> guard(lock);
+            return jobs.size();
+        }
+
+        std::pair<JobId, T> get_min() {
+            std::lock_guard<std::mutex> guard(lock);
+            if (jobs.empty())
+                throw std::out_of_range("get_min from empty DurableQueue");
+            const Entry &e = heap.get_min();
+            return std::make_pair(e.id, e.key);
+        }
+
+        JobId insert(const T &key) {
+            std::unique_lock<std::mutex> guard(lock);
+            check_failed();
+            JobId id = next_id;
+            apply_insert(id, key);
+            log(OP_INSERT, id, key);
+            maybe_commit(guard);
+            return id;
+        }
+
+        std::pair<JobId, T> pop() {
+            std::unique_lock<std::mutex> guard(lock);
+            check_failed();
+            if (jobs.empty())
+                throw std::out_of_range("Pop from empty DurableQueue");
+            Entry e = heap.pop();
+            jobs.erase(e.id);
+            log(OP_POP, e.id, e.key);
+            maybe_commit(guard);
+            return std::make_pair(e.id, e.key);
+        }
+
+        void decrease_key(JobId id, const T &new_key) {
+            std::unique_lock<std::mutex> guard(lock);
+            check_failed();
+            auto it = jobs.find(id);
+            if (it == jobs.end())
+                throw std::out_of_range("DurableQueue unknown job");
+            if (it->second->get_key().key < new_key)
+                throw std::out_of_range("DurableQueue key can't be increased");
+            apply_decrease(id, new_key);
+            log(OP_DECREASE, id, new_key);
+            maybe_commit(guard);
+        }
+
+        bool erase(JobId id) {
+            std::unique_lock<std::mutex> guard(lock);
+            check_failed();
+            auto it = jobs.find(id);
+            if (it == jobs.end())
+                return false;
+            T key = it->second->get_key().key;
+            apply_remove(id);
+            log(OP_ERASE, id, key);
+            maybe_commit(guard);
+            return true;
+        }
+
+        void commit() {
+            std::unique_lock<std::mutex> guard(lock);
+            commit_locked(guard);
+        }
+
+        void checkpoint() {
+            std::unique_lock<std::mutex> guard(lock);
+            synced.wait(guard, [this] { return !syncing; });
+            uint64_t lsn = next_lsn - 1;
+            uint64_t count = jobs.size();
+            std::vector<char> buf(4 + 4 + 8 + 8 + 8);
+            uint32_t magic = SNAPSHOT_MAGIC, key_size = sizeof(T);
+            std::memcpy(buf.data(), &magic, 4);
+            std::memcpy(buf.data() + 4, &key_size, 4);
+            std::memcpy(buf.data() + 8, &lsn, 8);
+            std::memcpy(buf.data() + 16, &next_id, 8);
+            std::memcpy(buf.data() + 24, &count, 8);
+            buf.reserve(buf.size() + count * (8 + sizeof(T)) + 4);
+            for (auto &j : jobs) {
+                const T &key = j.second->get_key().key;
+                const char *id = reinterpret_cast<const char *>(&j.first);
+                buf.insert(buf.end(), id, id + 8);
+                const char *k = reinterpret_cast<const char *>(&key);
+                buf.insert(buf.end(), k, k + sizeof(T));
+            }
+            uint32_t crc = crc32(buf.data(), buf.size());
+            const char *c = reinterpret_cast<const char *>(&crc);
+            buf.insert(buf.end(), c, c + 4);
+
+            std::string tmp = snapshot_path() + ".tmp";
+            int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                throw std::runtime_error("DurableQueue can't create " + tmp);
+            try {
+                write_all(fd, buf.data(), buf.size());
+                if (fsync(fd) != 0)
+                    throw std::runtime_error("DurableQueue fsync failed");
+            } catch (...) {
+                ::close(fd);
+                throw;
+            }
+            ::close(fd);
+            if (rename(tmp.c_str(), snapshot_path().c_str()) != 0)
+                throw std::runtime_error("DurableQueue can't rename " + tmp);
+            sync_dir(dir);
+            // log records up to lsn are in snapshot now
+            pending.clear();
+            pending_records = 0;
+            if (ftruncate(log_fd, 0) != 0 || lseek(log_fd, 0, SEEK_SET) < 0
+                || fdatasync(log_fd) != 0)
+                throw std::runtime_error("DurableQueue can't truncate " + log_path());
+            log_end = 0;
+            failed = false;
+            durable_lsn = lsn;
+        }
+    };
+}
+
+#endif // _ALG_DURABLE_QUEUE
@@ -0,0 +1,249 @@
+/*
+* External Memory Priority Queue (simplified sequence heap)
+* ExternalPriorityQueue<T, Compare> - min priority queue larger than memory
+*   T must be trivially copyable
+*   new elements go to an in-memory array heap, when it is full it is
+*   sorted and spilled to disk as a run; popped element is the smaller of
+*   insertion heap top and the smallest run head, run heads are read with
+*   large sequential reads and kept in a small heap;
+*   every fan_in runs of one level are merged into one run of next level;
+*   at most 2 * fan_in runs are live, beyond that the fan_in shortest are
+*   merged across levels, so the run buffers always fit the budget
+* Methods:
+*   1. ExternalPriorityQueue(size_t memory_bytes, const std::string &tmp_dir = "/tmp",
+*                            size_t fan_in = 32)
+*       half of memory_bytes is insertion heap, the rest is run buffers:
+*       2 * fan_in readers, a double buffered writer and the reader of
+*       the run being written
+*       throws std::invalid_argument if a buffer would be below one element
+*   2. size_t size() - number of elements,
+*      size_t peak_buffer_bytes() - most memory buffers took so far
+*   3. const T &top() - min element
+*       complexity: O(1)
+*   4. void push(const T &d) - insert element
+*       complexity: O(lg(M)) + O(1/B) amortized I/Os
+*   5. T pop() - pop min element
+*       complexity: O(lg(M) + lg(runs)) + O(1/B) amortized I/Os
+* I/O errors are reported with std::runtime_error.
+*/
+#ifndef _ALG_EXTERNAL_PRIORITY_QUEUE
+#define _ALG_EXTERNAL_PRIORITY_QUEUE
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include "ExternalSort.hpp"
+#include "KWayMerge.hpp"
+
+namespace alg {
+    template <typename T, typename Compare = std::less<T>>
+    class ExternalPriorityQueue {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "ExternalPriorityQueue requires trivially copyable T");
+        using Reader = external::RunReader<T>;
+
+        struct Run {
+            external::File file;
+            Reader reader;
+            size_t level;
+            size_t left;    // elements not popped yet
+        };
+
+        size_t memory;
+        size_t fan_in;
+        std::string dir;
+        size_t ins_capacity;
+        Compare comp;
+        std::vector<T> ins;          // array heap, ins.front() is min
+        std::vector<Run> runs;
+        std::vector<uint32_t> heads; // heap of non-empty runs by front
+        size_t _size = 0;
+        size_t peak = 0;
+
+        bool ins_greater(const T &a, const T &b) const {
+            return comp(b, a);
+        }
+        bool head_greater(uint32_t a, uint32_t b) const {
+            return comp(runs[b].reader.front(), runs[a].reader.front());
+        }
+        void rebuild_heads() {
+            heads.clear();
+            for (size_t i = 0; i < runs.size(); i++) {
+                if (!runs[i].reader.empty())
+                    heads.push_back(uint32_t(i));
+            }
+            std::make_heap(heads.begin(), heads.end(),
+                           [this](uint32_t a, uint32_t b) { return head_greater(a, b); });
+        }
+
+        size_t max_runs() const {
+            return 2 * fan_in;
+        }
+        // max_runs readers, then a merge adds a writer (two buffers) and
+        // the reader of its output
+        size_t run_buffer() const {
+            return memory / 2 / (max_runs() + 3) / sizeof(T);
+        }
+        void note_buffers(size_t buffers) {
+            peak = std::max(peak, ins.capacity() * sizeof(T) + buffers * run_buffer() * sizeof(T));
+        }
+
+        // sorted elements into a new run
+        template <typename Next>
+        void write_run(size_t count, size_t level, size_t readers, Next next) {
+            external::File f(external::temp_file(dir));
+            {
+                external::RunWriter<T> w(f.get(), run_buffer());
+                note_buffers(readers + 2);
+                for (size_t i = 0; i < count; i++)
+                    w.push(next());
+                w.finish();
+            }
+            Reader r(f.get(), run_buffer());
+            note_buffers(readers + 3);
+            runs.push_back(Run{std::move(f), std::move(r), level, count});
+        }
+
+        void spill() {
+            std::sort(ins.begin(), ins.end(), comp);
+            size_t i = 0;
+            write_run(ins.size(), 0, runs.size(), [&] { return ins[i++]; });
+            ins.clear();
+            compact();
+            rebuild_heads();
+        }
+
+        // merge runs of the given indexes into one run of level
+        void merge(const std::vector<size_t> &which, size_t level) {
+            std::vector<Reader> readers;
+            std::vector<external::File> merged_files;
+            std::vector<Run> rest;
+            std::vector<char> merged(runs.size(), 0);
+            size_t count = 0;
+            for (size_t i : which)
+                merged[i] = 1;
+            for (size_t i = 0; i < runs.size(); i++) {
+                if (merged[i]) {
+                    count += runs[i].left;
+                    readers.push_back(std::move(runs[i].reader));
+                    merged_files.push_back(std::move(runs[i].file));
+                } else {
+                    rest.push_back(std::move(runs[i]));
+                }
+            }
+            runs.swap(rest);
+            LoserTree<Reader, Compare> tree(std::move(readers), comp);
+            write_run(count, level, runs.size() + which.size(), [&] { return tree.pop(); });
+        }
+
+        // drop exhausted runs, merge full levels, then shortest runs while
+        // there are too many
+        void compact() {
+            runs.erase(std::remove_if(runs.begin(), runs.end(),
+                                      [](const Run &r) { return r.reader.empty(); }),
+                       runs.end());
+            size_t max_level = 0;
+            for (auto &r : runs)
+                max_level = std::max(max_level, r.level);
+            std::vector<size_t> which;
+            for (size_t level = 0; level <= max_level; level++) {
+                which.clear();
+                for (size_t i = 0; i < runs.size(); i++) {
+                    if (runs[i].level == level)
+                        which.push_back(i);
+                }
+                if (which.size() < fan_in)
+                    continue;
+                merge(which, level + 1);
+                max_level = std::max(max_level, level + 1);
+            }
+            while (runs.size() >= max_runs()) {
+                which.resize(runs.size());
+                for (size_t i = 0; i < runs.size(); i++)
+                    which[i] = i;
+                std::partial_sort(which.begin(), which.begin() + long(fan_in), which.end(),
+                                  [this](size_t a, size_t b) { return runs[a].left < runs[b].left; });
+                which.resize(fan_in);
+                size_t level = 0;
+                for (size_t i : which)
+                    level = std::max(level, runs[i].level);
+                merge(which, level);
+            }
+        }
+
+    public:
+        explicit ExternalPriorityQueue(size_t memory_bytes,
+                                       const std::string &tmp_dir = "/tmp",
+                                       size_t fan_in = 32, Compare c = Compare())
+            : memory(memory_bytes), fan_in(std::max<size_t>(fan_in, 2)),
+              dir(tmp_dir), comp(c) {
+            if (run_buffer() == 0)
+                throw std::invalid_argument("ExternalPriorityQueue memory is too small for fan_in");
+            ins_capacity = memory / 2 / sizeof(T);
+            ins.reserve(ins_capacity);
+            note_buffers(0);
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+        bool empty() const noexcept {
+            return _size == 0;
+        }
+        size_t peak_buffer_bytes() const noexcept {
+            return peak;
+        }
+
+        const T &top() const {
+            if (_size == 0)
+                throw std::out_of_range("top of empty ExternalPriorityQueue");
+            if (heads.empty())
+                return ins.front();
+            const T &r = runs[heads.front()].reader.front();
+            if (ins.empty() || !comp(ins.front(), r))
+                return r;
+            return ins.front();
+        }
+
+        void push(const T &d) {
+            if (ins.size() >= ins_capacity)
+                spill();
+            ins.push_back(d);
+            std::push_heap(ins.begin(), ins.end(),
+                           [this](const T &a, const T &b) { return ins_greater(a, b); });
+            _size++;
+        }
+
+        T pop() {
+            if (_size == 0)
+                throw std::out_of_range("Pop from empty ExternalPriorityQueue");
+            auto greater_head = [this](uint32_t a, uint32_t b) { return head_greater(a, b); };
+            bool from_ins = heads.empty()
+                || (!ins.empty() && comp(ins.front(), runs[heads.front()].reader.front()));
+            _size--;
+            if (from_ins) {
+                std::pop_heap(ins.begin(), ins.end(),
+                              [this](const T &a, const T &b) { return ins_greater(a, b); });
+                T res = ins.back();
+                ins.pop_back();
+                return res;
+            }
+            std::pop_heap(heads.begin(), heads.end(), greater_head);
+            Run &run = runs[heads.back()];
+            T res = run.reader.front();
+            run.reader.advance();
+            run.left--;
+            if (run.reader.empty())
+                heads.pop_back();
+            else
+                std::push_heap(heads.begin(), heads.end(), greater_head);
+            return res;
+        }
+    };
+}
+
+#endif // _ALG_EXTERNAL_PRIORITY_QUEUE
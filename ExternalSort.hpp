@@ -0,0 +1,425 @@
+/*
+* External Memory Sort
+* ExternalSorter<T, Compare, Heap> - sorts streams larger than memory
+*   T must be trivially copyable, runs are kept in unlinked temporary files
+*   1. replacement selection over Heap produces sorted runs of about 2x
+*      heap size on random input; default external::VectorHeap keeps
+*      entries in one array, node based heaps (Bheap, FibHeap) also fit
+*      but their per node overhead is charged to the memory budget
+*   2. runs are written with double buffering: one buffer is filled while
+*      the other one is written by a background task
+*   3. runs are merged with LoserTree over buffered file readers, every
+*      fan_in runs of one level are merged into a run of next level, so
+*      at most about fan_in * levels files are open at once
+* Methods:
+*   1. ExternalSorter(size_t memory_bytes, const std::string &tmp_dir = "/tmp",
+*                     size_t fan_in = 128)
+*       memory_bytes bounds everything at once: write buffers take up to
+*       1/8, merges of full levels while pushing read through 1/8, the
+*       heap gets the rest; finish() frees the heap before the final merge
+*   2. void push(const T &d) - add element
+*       complexity: O(lg(M)) heap operations
+*   3. void finish(F &&out) - sort and pass result to
+*       out(const T *data, size_t n) in batches
+*       NOTE: sorter is reset after finish
+*   4. size_t runs() - number of runs produced so far
+*   5. void sort_file(const std::string &in, const std::string &out, ...)
+*       sort binary file of T
+* I/O errors are reported with std::runtime_error.
+*/
+#ifndef _ALG_EXTERNAL_SORT
+#define _ALG_EXTERNAL_SORT
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+#include "Bheap.hpp"
+#include "KWayMerge.hpp"
+
+namespace alg {
+    namespace external {
+        // unlinked temporary file, removed by OS once closed
+        inline std::FILE *temp_file(const std::string &dir) {
+            std::string path = dir + "/alg_run_XXXXXX";
+            std::vector<char> name(path.begin(), path.end());
+            name.push_back('\0');
+            int fd = mkstemp(name.data());
+            if (fd < 0)
+                throw std::runtime_error("Can't create temporary file in " + dir);
+            unlink(name.data());
+            std::FILE *f = fdopen(fd, "w+b");
+            if (!f) {
+                close(fd);
+                throw std::runtime_error("Can't open temporary file");
+            }
+            return f;
+        }
+
+        struct FileCloser {
+            void operator()(std::FILE *f) const {
+                std::fclose(f);
+            }
+        };
+        using File = std::unique_ptr<std::FILE, FileCloser>;
+
+        // writes T to file, buffer is written in background while next
+        // one is being filled
+        template <typename T>
+        class RunWriter {
+            std::FILE *f;
+            std::vector<T> front, back;
+            size_t cap;
+            std::future<size_t> pending;
+
+            void wait() {
+                if (pending.valid() && pending.get() != back.size())
+                    throw std::runtime_error("External sort write failed");
+            }
+        public:
+            RunWriter(std::FILE *file, size_t buf_elems)
+                : f(file), cap(std::max<size_t>(buf_elems, 1)) {
+                front.reserve(cap);
+                back.reserve(cap);
+            }
+            ~RunWriter() {
+                if (pending.valid())
+                    pending.wait();
+            }
+            void push(const T &d) {
+                front.push_back(d);
+                if (front.size() == cap)
+                    flush_async();
+            }
+            void flush_async() {
+                wait();
+                std::swap(front, back);
+                front.clear();
+                if (back.empty())
+                    return;
+                std::FILE *file = f;
+                const T *data = back.data();
+                size_t n = back.size();
+                pending = std::async(std::launch::async, [file, data, n] {
+                    return std::fwrite(data, sizeof(T), n, file);
+                });
+            }
+            void finish() {
+                flush_async();
+                wait();
+                back.clear();
+                if (std::fflush(f) != 0)
+                    throw std::runtime_error("External sort write failed");
+            }
+        };
+
+        // array binary heap, min by operator <
+        template <typename T>
+        class VectorHeap {
+            std::vector<T> a;
+            static bool greater(const T &x, const T &y) {
+                return y < x;
+            }
+        public:
+            size_t size() const noexcept {
+                return a.size();
+            }
+            void reserve(size_t n) {
+                a.reserve(n);
+            }
+            const T &get_min() const {
+                if (a.empty())
+                    throw std::out_of_range("get_min from empty VectorHeap");
+                return a.front();
+            }
+            void insert(const T &d) {
+                a.push_back(d);
+                std::push_heap(a.begin(), a.end(), greater);
+            }
+            T pop() {
+                if (a.empty())
+                    throw std::out_of_range("Pop from empty VectorHeap");
+                std::pop_heap(a.begin(), a.end(), greater);
+                T res = a.back();
+                a.pop_back();
+                return res;
+            }
+            // pop and insert d at once: the hole at root goes down along
+            // smaller children to a leaf, then d sifts up from there, new
+            // elements mostly belong near leaves (Floyd)
+            void replace_top(const T &d) {
+                if (a.empty())
+                    throw std::out_of_range("replace_top of empty VectorHeap");
+                size_t n = a.size(), i = 0;
+                for (size_t c = 1; c < n; c = 2 * i + 1) {
+                    if (c + 1 < n && a[c + 1] < a[c])
+                        c++;
+                    a[i] = a[c];
+                    i = c;
+                }
+                while (i > 0) {
+                    size_t p = (i - 1) / 2;
+                    if (!(d < a[p]))
+                        break;
+                    a[i] = a[p];
+                    i = p;
+                }
+                a[i] = d;
+            }
+        };
+
+        // memory one element takes in a heap, node heaps pay for shared_ptr
+        // control block, links and allocator header
+        template <template <typename> class Heap, typename E>
+        struct HeapTraits {
+            static constexpr size_t bytes = sizeof(E) + 112;
+            static void reserve(Heap<E> &, size_t) {
+            }
+            static void replace_top(Heap<E> &h, const E &d) {
+                h.pop();
+                h.insert(d);
+            }
+        };
+        template <typename E>
+        struct HeapTraits<VectorHeap, E> {
+            static constexpr size_t bytes = sizeof(E);
+            static void reserve(VectorHeap<E> &h, size_t n) {
+                h.reserve(n);
+            }
+            static void replace_top(VectorHeap<E> &h, const E &d) {
+                h.replace_top(d);
+            }
+        };
+
+        // buffered sequential reader, Source for LoserTree
+        template <typename T>
+        class RunReader {
+            std::FILE *f;
+            std::vector<T> buf;
+            size_t pos = 0;
+            size_t cnt = 0;
+
+            void refill() {
+                cnt = std::fread(buf.data(), sizeof(T), buf.size(), f);
+                pos = 0;
+                if (cnt == 0 && std::ferror(f))
+                    throw std::runtime_error("External sort read failed");
+            }
+        public:
+            using value_type = T;
+            RunReader(std::FILE *file, size_t buf_elems)
+                : f(file), buf(std::max<size_t>(buf_elems, 1)) {
+                std::rewind(f);
+                refill();
+            }
+            bool empty() const {
+                return pos == cnt;
+            }
+            const T &front() const {
+                return buf[pos];
+            }
+            void advance() {
+                if (++pos == cnt)
+                    refill();
+            }
+        };
+    }
+
+    template <typename T, typename Compare = std::less<T>,
+              template <typename> class Heap = external::VectorHeap>
+    class ExternalSorter {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "ExternalSorter requires trivially copyable T");
+
+        struct Entry {
+            uint32_t run;
+            T value;
+            bool operator < (const Entry &r) const {
+                return run < r.run || (run == r.run && Compare()(value, r.value));
+            }
+        };
+
+        size_t memory;
+        size_t fan_in;
+        std::string dir;
+        size_t capacity;
+        Heap<Entry> heap;
+        std::vector<std::vector<external::File>> levels;
+        std::unique_ptr<external::RunWriter<T>> writer;
+        uint32_t cur_run = 0;
+        bool has_last = false;
+        T last;
+
+        size_t io_buffer() const {
+            // double buffered writer takes two, capped at 4Mb each
+            return std::max<size_t>(std::min<size_t>(memory / 16, size_t(4) << 20) / sizeof(T), 1);
+        }
+        size_t write_bytes() const {
+            return 2 * io_buffer() * sizeof(T);
+        }
+
+        void open_run() {
+            levels[0].emplace_back(external::temp_file(dir));
+            writer.reset(new external::RunWriter<T>(levels[0].back().get(), io_buffer()));
+        }
+        void close_run() {
+            if (!writer)
+                return;
+            writer->finish();
+            writer.reset();
+            for (size_t l = 0; levels[l].size() >= fan_in; l++) {
+                if (l + 1 == levels.size())
+                    levels.emplace_back();
+                levels[l + 1].emplace_back(external::temp_file(dir));
+                // heap is full here, only the reserved part is free
+                merge_runs(levels[l], levels[l + 1].back(), memory / 8);
+                levels[l].clear();
+            }
+        }
+
+        // write the smallest entry, it stays in heap
+        void emit_min() {
+            const Entry &e = heap.get_min();
+            if (!writer || e.run != cur_run) {
+                close_run();
+                open_run();
+                cur_run = e.run;
+            }
+            writer->push(e.value);
+            last = e.value;
+            has_last = true;
+        }
+
+        LoserTree<external::RunReader<T>, Compare> merger(std::vector<external::File> &runs,
+                                                          size_t read_bytes) {
+            using Reader = external::RunReader<T>;
+            size_t per_run = std::max<size_t>(read_bytes / runs.size() / sizeof(T), 1);
+            std::vector<Reader> readers;
+            readers.reserve(runs.size());
+            for (auto &f : runs)
+                readers.emplace_back(f.get(), per_run);
+            return LoserTree<Reader, Compare>(std::move(readers));
+        }
+
+        void merge_runs(std::vector<external::File> &runs, external::File &out,
+                        size_t read_bytes) {
+            auto tree = merger(runs, read_bytes);
+            external::RunWriter<T> w(out.get(), io_buffer());
+            while (!tree.empty())
+                w.push(tree.pop());
+            w.finish();
+        }
+
+    public:
+        explicit ExternalSorter(size_t memory_bytes, const std::string &tmp_dir = "/tmp",
+                                size_t fan_in = 128)
+            : memory(memory_bytes), fan_in(std::max<size_t>(fan_in, 2)), dir(tmp_dir),
+              levels(1) {
+            size_t reserved = write_bytes() + memory / 8;
+            size_t heap_bytes = memory > reserved ? memory - reserved : 0;
+            capacity = std::max<size_t>(heap_bytes / external::HeapTraits<Heap, Entry>::bytes, 1);
+            external::HeapTraits<Heap, Entry>::reserve(heap, capacity);
+        }
+
+        size_t runs() const noexcept {
+            size_t n = 0;
+            for (auto &l : levels)
+                n += l.size();
+            return n;
+        }
+
+        void push(const T &d) {
+            bool full = heap.size() >= capacity;
+            if (full)
+                emit_min();
+            uint32_t run = cur_run;
+            // element smaller than the last written one waits for next run
+            if (has_last && Compare()(d, last))
+                run = cur_run + 1;
+            if (full)
+                external::HeapTraits<Heap, Entry>::replace_top(heap, Entry{run, d});
+            else
+                heap.insert(Entry{run, d});
+        }
+        template <typename It>
+        void push(It first, It last_it) {
+            for (; first != last_it; ++first)
+                push(*first);
+        }
+
+        template <typename F>
+        void finish(F &&out) {
+            while (heap.size() > 0) {
+                emit_min();
+                heap.pop();
+            }
+            close_run();
+            heap = Heap<Entry>();
+            size_t read_bytes = memory > write_bytes() ? memory - write_bytes() : memory / 2;
+            std::vector<external::File> files;
+            for (auto &l : levels) {
+                for (auto &f : l)
+                    files.push_back(std::move(f));
+            }
+            levels.clear();
+            levels.emplace_back();
+            // last levels may still leave too many runs for one pass
+            while (files.size() > fan_in) {
+                std::vector<external::File> next, group;
+                for (size_t i = 0; i < files.size(); i += fan_in) {
+                    size_t j = std::min(files.size(), i + fan_in);
+                    group.clear();
+                    for (size_t k = i; k < j; k++)
+                        group.push_back(std::move(files[k]));
+                    next.emplace_back(external::temp_file(dir));
+                    merge_runs(group, next.back(), read_bytes);
+                }
+                files.swap(next);
+            }
+            size_t batch = io_buffer();
+            std::vector<T> buf(batch);
+            if (!files.empty()) {
+                auto tree = merger(files, read_bytes);
+                size_t n;
+                while ((n = tree.pop_batch(buf.data(), batch)) > 0)
+                    out(static_cast<const T *>(buf.data()), n);
+            }
+            cur_run = 0;
+            has_last = false;
+            external::HeapTraits<Heap, Entry>::reserve(heap, capacity);
+        }
+
+        static void sort_file(const std::string &in, const std::string &out,
+                              size_t memory_bytes, const std::string &tmp_dir = "/tmp") {
+            external::File fin(std::fopen(in.c_str(), "rb"));
+            if (!fin)
+                throw std::runtime_error("Can't open " + in);
+            external::File fout(std::fopen(out.c_str(), "wb"));
+            if (!fout)
+                throw std::runtime_error("Can't open " + out);
+            ExternalSorter sorter(memory_bytes, tmp_dir);
+            std::vector<T> buf(sorter.io_buffer());
+            size_t n;
+            while ((n = std::fread(buf.data(), sizeof(T), buf.size(), fin.get())) > 0)
+                sorter.push(buf.begin(), buf.begin() + n);
+            if (std::ferror(fin.get()))
+                throw std::runtime_error("Can't read " + in);
+            sorter.finish([&](const T *data, size_t cnt) {
+                if (std::fwrite(data, sizeof(T), cnt, fout.get()) != cnt)
+                    throw std::runtime_error("Can't write " + out);
+            });
+            if (std::fflush(fout.get()) != 0)
+                throw std::runtime_error("Can't write " + out);
+        }
+    };
+}
+
+#endif // _ALG_EXTERNAL_SORT
@@ -20,23 +20,41 @@
 *    6. T pop() - pop element from heap
 *       return this element to user
 *       complexity: O(lg(N))*
+*    7. void erase(NodePtr &x) - remove x from heap
+*       complexity: O(lg(N))*
+*    8. void save(std::ostream &out) - write heap shape, marks and keys
+*       T must be trivially copyable, keys are written in one block
+*       complexity: O(N)
+*    9. void load(std::istream &in) - replace heap with saved one,
+*       restores exactly the same shape without consolidation
+*       complexity: O(N)
+*    10. void insert_batch(const T *keys, size_t n, NodePtr *out = nullptr)
+*       insert n elements, they are spliced into root list at once, out
+*       receives their nodes
+*       complexity: O(n)
+*    11. size_t pop_batch(T *out, size_t n) - pop up to n elements in
+*       order, consolidation buffers are allocated once per batch
+*       complexity: O(n lg(N))*
 *    * in worst case O(N)
 *    ** in worst case O(lg(N))
 */
 #ifndef _ALG_FIB_HEAP
-#define _AlG_FIB_HEAP
+#define _ALG_FIB_HEAP
 
 #include <memory>
 #include <exception>
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "HeapSnapshot.hpp"
 
 namespace alg {
     template <typename T> class FibHeap;
 
     template<typename T>
     class FibHeapNode {
-        using NodePtr = std::shared_ptr<FibHeapNode>;:
+        using NodePtr = std::shared_ptr<FibHeapNode>;
         NodePtr p;
         NodePtr child;
         NodePtr left;
@@ -48,7 +66,7 @@ namespace alg {
         inline bool compare_less(const NodePtr &r) const noexcept {
             return key < r->key;
         }
-        inline T &get_key() const noexcept {
+        inline T &get_key() noexcept {
             return key;
         }
         friend class FibHeap<T>;
@@ -57,6 +75,7 @@ namespace alg {
     template <typename T>
     class FibHeap {
         using NodePtr = std::shared_ptr<FibHeapNode<T>>;
+        static constexpr uint32_t SNAPSHOT_MAGIC = 0x31504846; // "FHP1"
         std::allocator<T> alloc;
         NodePtr min;
         size_t _size = 0;
@@ -97,11 +116,12 @@ namespace alg {
             y->mark = false;
         }
 
-        void consolidate() noexcept {
+        void consolidate(std::vector<NodePtr> &A, std::vector<NodePtr> &orig_nodes) noexcept {
             //calc num_trees probably can be optimized
             size_t num_trees = 0;
             NodePtr x = min;
-            std::vector<NodePtr> A, orig_nodes;
+            A.clear();
+            orig_nodes.clear();
             size_t max_d = 0;
             if (x) do {
                 max_d = std::max(max_d,x->degree);
@@ -125,7 +145,7 @@ namespace alg {
                 A[d] = x;
             }
             min = nullptr;
-            for (int i = 0; i < node_vec_size; i++) {
+            for (size_t i = 0; i < node_vec_size; i++) {
                 if (A[i]) {
                     insert_node(A[i]);
                 }
@@ -158,6 +178,33 @@ namespace alg {
             }
         }
 
+        // pop min, A and orig_nodes are scratch buffers for consolidate
+        T pop_min(std::vector<NodePtr> &A, std::vector<NodePtr> &orig_nodes) {
+            auto z = min;
+            if (!z)
+                throw std::out_of_range("Pop from empty FibHeap");
+            auto x = z->child;
+            auto next_x = x;
+            if (x) do {
+                x = next_x;
+                x->p = nullptr;
+                next_x = x->right;
+                x->left->right = x->left;
+                x->right->left = x->right;
+                insert_node(x);
+            } while (next_x != x);
+            min = z->right;
+            if (min == z)
+                min = nullptr;
+            if (z->right  != z)
+                z->right->left = z->left;
+            if (z->left != z)
+                z->left->right = z->right;
+            _size--;
+            consolidate(A, orig_nodes);
+            return z->key;
+        }
+
     public:
         size_t size() const noexcept {
             return _size;
@@ -187,30 +234,51 @@ namespace alg {
         }
 
         T pop() {
-            auto z = min;
-            if (!z)
-                throw std::out_of_range("Pop from empty FibHeap");
-            auto x = z->child;
-            auto next_x = x;
-            if (x) do {
-                x = next_x;
-                x->p = nullptr;
-                next_x = x->right;
-                x->left->right = x->left;
-                x->right->left = x->right;
-                insert_node(x);
-            } while (next_x != x);
-            min = z->right;
-            if (min == z)
-                min = nullptr;
-            if (z->right  != z)
-                z->right->left = z->left;
-            if (z->left != z)
-                z->left->right = z->right;
-            _size--;
-            consolidate();
-            return z->key;
-        };
+            std::vector<NodePtr> A, orig_nodes;
+            return pop_min(A, orig_nodes);
+        }
+        size_t pop_batch(T *out, size_t n) {
+            std::vector<NodePtr> A, orig_nodes;
+            size_t i = 0;
+            for (; i < n && min; i++)
+                out[i] = pop_min(A, orig_nodes);
+            return i;
+        }
+
+        void insert_batch(const T *keys, size_t n, NodePtr *out = nullptr) {
+            if (n == 0)
+                return;
+            // circular list of new nodes, then one splice
+            NodePtr first, last, best;
+            for (size_t i = 0; i < n; i++) {
+                NodePtr x = std::allocate_shared<FibHeapNode<T>>(alloc);
+                x->key = keys[i];
+                if (last) {
+                    last->right = x;
+                    x->left = last;
+                } else {
+                    first = x;
+                }
+                if (!best || x->compare_less(best))
+                    best = x;
+                last = x;
+                if (out)
+                    out[i] = x;
+            }
+            if (!min) {
+                last->right = first;
+                first->left = last;
+            } else {
+                auto l = min->left;
+                l->right = first;
+                first->left = l;
+                last->right = min;
+                min->left = last;
+            }
+            if (!min || best->compare_less(min))
+                min = best;
+            _size += n;
+        }
 
         void decrease_key(NodePtr &N, const T &new_key) {
             if (N->key < new_key)
@@ -224,7 +292,108 @@ namespace alg {
             if (N->compare_less(min))
                 min = N;
         }
+
+        void erase(NodePtr &N) {
+            auto y = N->p;
+            if (y != nullptr) {
+                cut(N,y);
+                cascading_cut(y);
+            }
+            min = N;
+            pop();
+        }
+
+        void save(std::ostream &out) const {
+            static_assert(std::is_trivially_copyable<T>::value,
+                          "FibHeap::save requires trivially copyable T");
+            std::vector<uint32_t> degrees;
+            std::vector<uint8_t> marks;
+            std::vector<T> keys;
+            degrees.reserve(_size);
+            marks.reserve(_size);
+            keys.reserve(_size);
+            // preorder, roots start from min, children follow their parent
+            std::vector<FibHeapNode<T> *> stack;
+            auto r = min.get();
+            if (r) do {
+                stack.push_back(r);
+                while (!stack.empty()) {
+                    auto x = stack.back();
+                    stack.pop_back();
+                    degrees.push_back(uint32_t(x->degree));
+                    marks.push_back(x->mark);
+                    keys.push_back(x->key);
+                    size_t first = stack.size();
+                    auto c = x->child.get();
+                    if (c) do {
+                        stack.push_back(c);
+                        c = c->right.get();
+                    } while (c != x->child.get());
+                    std::reverse(stack.begin() + first, stack.end());
+                }
+                r = r->right.get();
+            } while (r != min.get());
+            snapshot::write_header(out, SNAPSHOT_MAGIC, sizeof(T), keys.size());
+            snapshot::write(out, degrees.data(), degrees.size());
+            snapshot::write(out, marks.data(), marks.size());
+            snapshot::write(out, keys.data(), keys.size());
+        }
+
+        void load(std::istream &in) {
+            static_assert(std::is_trivially_copyable<T>::value,
+                          "FibHeap::load requires trivially copyable T");
+            uint64_t n = snapshot::read_header(in, SNAPSHOT_MAGIC, sizeof(T),
+                                               sizeof(uint32_t) + sizeof(uint8_t) + sizeof(T));
+            std::vector<uint32_t> degrees;
+            std::vector<uint8_t> marks;
+            std::vector<T> keys;
+            snapshot::read_vector(in, degrees, n);
+            snapshot::read_vector(in, marks, n);
+            snapshot::read_vector(in, keys, n);
+            struct Frame {
+                NodePtr node;
+                size_t left;
+            };
+            // append x to circular list starting at first
+            auto append = [](NodePtr &first, NodePtr &x) {
+                if (!first) {
+                    first = x;
+                    x->left = x;
+                    x->right = x;
+                    return;
+                }
+                auto last = first->left;
+                last->right = x;
+                x->left = last;
+                x->right = first;
+                first->left = x;
+            };
+            std::vector<Frame> stack;
+            NodePtr new_min;
+            for (size_t i = 0; i < n; i++) {
+                NodePtr x = std::allocate_shared<FibHeapNode<T>>(alloc);
+                x->key = keys[i];
+                x->degree = degrees[i];
+                x->mark = marks[i] != 0;
+                if (stack.empty()) {
+                    append(new_min, x);
+                } else {
+                    Frame &f = stack.back();
+                    x->p = f.node;
+                    append(f.node->child, x);
+                    f.left--;
+                }
+                if (degrees[i] > 0)
+                    stack.push_back(Frame{x, degrees[i]});
+                while (!stack.empty() && stack.back().left == 0)
+                    stack.pop_back();
+            }
+            if (!stack.empty())
+                throw std::runtime_error("FibHeap snapshot is corrupted");
+            min = new_min;
+            _size = n;
+        }
     };
 };
 
-#endif // _AlG_FIB_HEAP
+#endif // _ALG_FIB_HEAP
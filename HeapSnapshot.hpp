@@ -0,0 +1,85 @@
+/*
+* Binary snapshot helpers for heap save/load
+* Snapshot layout:
+*   uint32_t magic, uint32_t key size, uint64_t node count,
+*   then per-heap arrays of node count elements, each written in one block
+*   (nodes are listed in preorder, roots in root list order)
+* read_header checks node count against the bytes left in a seekable
+* stream, read_vector grows by chunks, so a corrupt count can't make load
+* allocate much more than the stream holds
+*/
+#ifndef _ALG_HEAP_SNAPSHOT
+#define _ALG_HEAP_SNAPSHOT
+
+#include <cstdint>
+#include <algorithm>
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace alg {
+    namespace snapshot {
+        template <typename P>
+        inline void write(std::ostream &out, const P *data, size_t n) {
+            static_assert(std::is_trivially_copyable<P>::value,
+                          "snapshot requires trivially copyable data");
+            out.write(reinterpret_cast<const char *>(data), std::streamsize(n * sizeof(P)));
+            if (!out)
+                throw std::runtime_error("Heap snapshot write failed");
+        }
+        template <typename P>
+        inline void read(std::istream &in, P *data, size_t n) {
+            static_assert(std::is_trivially_copyable<P>::value,
+                          "snapshot requires trivially copyable data");
+            in.read(reinterpret_cast<char *>(data), std::streamsize(n * sizeof(P)));
+            if (!in)
+                throw std::runtime_error("Heap snapshot is truncated");
+        }
+
+        // read n elements into v, allocating no more than what was read so far
+        template <typename P>
+        inline void read_vector(std::istream &in, std::vector<P> &v, uint64_t n) {
+            constexpr uint64_t CHUNK = (uint64_t(1) << 20) / sizeof(P) + 1;
+            v.clear();
+            while (v.size() < n) {
+                size_t done = v.size();
+                size_t step = size_t(std::min(n - done, std::max<uint64_t>(done, CHUNK)));
+                v.resize(done + step);
+                read(in, v.data() + done, step);
+            }
+        }
+
+        inline void write_header(std::ostream &out, uint32_t magic,
+                                 uint32_t key_size, uint64_t count) {
+            write(out, &magic, 1);
+            write(out, &key_size, 1);
+            write(out, &count, 1);
+        }
+        // return node count, node_bytes - size of all arrays per node
+        inline uint64_t read_header(std::istream &in, uint32_t magic, uint32_t key_size,
+                                    size_t node_bytes) {
+            uint32_t m, ks;
+            uint64_t count;
+            read(in, &m, 1);
+            read(in, &ks, 1);
+            read(in, &count, 1);
+            if (m != magic || ks != key_size)
+                throw std::runtime_error("Heap snapshot has wrong format");
+            std::istream::pos_type pos = in.tellg();
+            if (pos != std::istream::pos_type(-1)) {
+                in.seekg(0, std::ios::end);
+                std::istream::pos_type end = in.tellg();
+                in.seekg(pos);
+                if (end != std::istream::pos_type(-1) && end >= pos
+                    && count > uint64_t(end - pos) / node_bytes)
+                    throw std::runtime_error("Heap snapshot is truncated");
+            }
+            return count;
+        }
+    }
+}
+
+#endif // _ALG_HEAP_SNAPSHOT
@@ -0,0 +1,235 @@
+/*
+* Huffman and Canonical Code Builder
+* HuffmanBuilder - computes optimal prefix code lengths from symbol
+*   frequencies, scratch buffers are kept between builds
+*   small alphabets use the classic heap method, larger ones are radix
+*   sorted (skipped if frequencies already ascend) and merged with the
+*   linear two-queue method; length-limited codes use package-merge
+*   when the unlimited code is too long; codes are never longer than 64
+*   bits, so canonical() codes always fit in uint64_t
+* Methods:
+*   1. void lengths(const uint64_t *freq, size_t n, uint8_t *len,
+*                   unsigned max_len = 0)
+*       len[i] = code length of symbol i, 0 for symbols with zero frequency,
+*       a single used symbol gets length 1; max_len = 0 or above 64 means
+*       a limit of 64, which only skewed (Fibonacci-like) frequencies reach
+*       throws std::invalid_argument if 2^max_len < used symbols
+*       complexity: O(n) for sorted input, O(n * digits) otherwise,
+*       O(n * max_len) with package-merge
+*   2. static void canonical(const uint8_t *len, size_t n, uint64_t *codes)
+*       canonical codes: shorter codes first, equal lengths in symbol order,
+*       codes[i] holds len[i] low bits, first bit is the most significant
+*       complexity: O(n + max length)
+*/
+#ifndef _ALG_HUFFMAN_CODE
+#define _ALG_HUFFMAN_CODE
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+
+namespace alg {
+    class HuffmanBuilder {
+        static constexpr size_t HEAP_MAX = 64;  // below this the heap method is faster
+        static constexpr unsigned MAX_CODE = 64;
+
+        std::vector<uint32_t> order;   // used symbols by ascending frequency
+        std::vector<uint32_t> tmp;
+        std::vector<uint64_t> weight;  // leaves then internal nodes
+        std::vector<uint32_t> parent;
+        std::vector<uint32_t> depth;
+        std::vector<std::vector<bool>> is_leaf;
+        std::vector<uint64_t> level, next_level;
+
+        // stable LSD radix sort of order by freq, passes with one digit value are skipped
+        void radix_sort(const uint64_t *freq) {
+            size_t n = order.size();
+            size_t count[8][256] = {};
+            for (uint32_t s : order) {
+                uint64_t f = freq[s];
+                for (int d = 0; d < 8; d++)
+                    count[d][(f >> (8 * d)) & 0xff]++;
+            }
+            tmp.resize(n);
+            for (int d = 0; d < 8; d++) {
+                if (count[d][(freq[order[0]] >> (8 * d)) & 0xff] == n)
+                    continue;
+                size_t pos = 0;
+                for (auto &c : count[d]) {
+                    size_t t = c;
+                    c = pos;
+                    pos += t;
+                }
+                for (uint32_t s : order)
+                    tmp[count[d][(freq[s] >> (8 * d)) & 0xff]++] = s;
+                order.swap(tmp);
+            }
+        }
+
+        // leaves 0..n-1 are sorted by weight, fill depth of leaves
+        void two_queue(size_t n) {
+            weight.resize(2 * n - 1);
+            parent.resize(2 * n - 1);
+            size_t leaf = 0, head = n, tail = n;
+            auto take = [&]() {
+                if (leaf < n && (head == tail || weight[leaf] <= weight[head]))
+                    return leaf++;
+                return head++;
+            };
+            for (; tail < 2 * n - 1; tail++) {
+                size_t a = take();
+                size_t b = take();
+                weight[tail] = weight[a] + weight[b];
+                parent[a] = parent[b] = uint32_t(tail);
+            }
+            depth.resize(2 * n - 1);
+            depth[2 * n - 2] = 0;
+            for (size_t i = 2 * n - 2; i-- > 0;)
+                depth[i] = depth[parent[i]] + 1;
+        }
+
+        void heap_method(size_t n) {
+            weight.resize(2 * n - 1);
+            parent.resize(2 * n - 1);
+            using Item = std::pair<uint64_t, uint32_t>;
+            std::vector<Item> heap;
+            heap.reserve(n);
+            for (size_t i = 0; i < n; i++)
+                heap.emplace_back(weight[i], uint32_t(i));
+            std::make_heap(heap.begin(), heap.end(), std::greater<Item>());
+            for (size_t next = n; heap.size() > 1; next++) {
+                std::pop_heap(heap.begin(), heap.end(), std::greater<Item>());
+                Item a = heap.back();
+                heap.pop_back();
+                std::pop_heap(heap.begin(), heap.end(), std::greater<Item>());
+                Item b = heap.back();
+                heap.pop_back();
+                weight[next] = a.first + b.first;
+                parent[a.second] = parent[b.second] = uint32_t(next);
+                heap.emplace_back(weight[next], uint32_t(next));
+                std::push_heap(heap.begin(), heap.end(), std::greater<Item>());
+            }
+            depth.resize(2 * n - 1);
+            depth[2 * n - 2] = 0;
+            for (size_t i = 2 * n - 2; i-- > 0;)
+                depth[i] = depth[parent[i]] + 1;
+        }
+
+        // leaves 0..n-1 are sorted by weight, fill depth of leaves
+        void package_merge(size_t n, unsigned max_len) {
+            is_leaf.resize(max_len);
+            // deepest level holds only leaves
+            level.assign(weight.begin(), weight.begin() + n);
+            is_leaf[max_len - 1].assign(n, true);
+            for (unsigned d = max_len - 1; d-- > 0;) {
+                std::vector<bool> &flags = is_leaf[d];
+                flags.clear();
+                next_level.clear();
+                size_t packages = level.size() / 2;
+                size_t i = 0, p = 0;
+                while (i < n || p < packages) {
+                    uint64_t pw = p < packages ? level[2 * p] + level[2 * p + 1] : 0;
+                    if (i < n && (p == packages || weight[i] <= pw)) {
+                        next_level.push_back(weight[i++]);
+                        flags.push_back(true);
+                    } else {
+                        next_level.push_back(pw);
+                        flags.push_back(false);
+                        p++;
+                    }
+                    if (next_level.size() == 2 * n - 2)
+                        break;
+                }
+                level.swap(next_level);
+            }
+            std::fill(depth.begin(), depth.begin() + n, 0);
+            size_t k = 2 * n - 2;
+            for (unsigned d = 0; d < max_len && k > 0; d++) {
+                const std::vector<bool> &flags = is_leaf[d];
+                size_t leaves = 0;
+                for (size_t j = 0; j < k; j++)
+                    leaves += flags[j];
+                // first items are the smallest leaves, each one adds a bit
+                for (size_t j = 0; j < leaves; j++)
+                    depth[j]++;
+                k = 2 * (k - leaves);
+            }
+        }
+
+    public:
+        void lengths(const uint64_t *freq, size_t n, uint8_t *len, unsigned max_len = 0) {
+            order.clear();
+            bool sorted = true;
+            for (size_t i = 0; i < n; i++) {
+                len[i] = 0;
+                if (freq[i] == 0)
+                    continue;
+                if (!order.empty() && freq[i] < freq[order.back()])
+                    sorted = false;
+                order.push_back(uint32_t(i));
+            }
+            size_t m = order.size();
+            if (m == 0)
+                return;
+            if (max_len == 0 || max_len > MAX_CODE)
+                max_len = MAX_CODE;
+            if (max_len < 64 && (uint64_t(1) << max_len) < m)
+                throw std::invalid_argument("HuffmanBuilder max_len is too small for alphabet");
+            if (m == 1) {
+                len[order[0]] = 1;
+                return;
+            }
+            if (m <= HEAP_MAX) {
+                weight.resize(2 * m - 1);
+                for (size_t i = 0; i < m; i++)
+                    weight[i] = freq[order[i]];
+                heap_method(m);
+            } else {
+                if (!sorted)
+                    radix_sort(freq);
+                weight.resize(2 * m - 1);
+                for (size_t i = 0; i < m; i++)
+                    weight[i] = freq[order[i]];
+                two_queue(m);
+            }
+            unsigned longest = 0;
+            for (size_t i = 0; i < m; i++)
+                longest = std::max<unsigned>(longest, depth[i]);
+            if (longest > max_len) {
+                // package-merge needs leaves sorted by weight
+                if (m <= HEAP_MAX && !sorted)
+                    std::stable_sort(order.begin(), order.end(),
+                                     [freq](uint32_t a, uint32_t b) { return freq[a] < freq[b]; });
+                for (size_t i = 0; i < m; i++)
+                    weight[i] = freq[order[i]];
+                package_merge(m, max_len);
+            }
+            for (size_t i = 0; i < m; i++)
+                len[order[i]] = uint8_t(depth[i]);
+        }
+
+        static void canonical(const uint8_t *len, size_t n, uint64_t *codes) {
+            uint64_t count[MAX_CODE + 1] = {};
+            for (size_t i = 0; i < n; i++) {
+                if (len[i] > MAX_CODE)
+                    throw std::invalid_argument("HuffmanBuilder code is longer than 64 bits");
+                count[len[i]]++;
+            }
+            count[0] = 0;
+            uint64_t next[MAX_CODE + 1] = {};
+            uint64_t code = 0;
+            for (unsigned l = 1; l <= MAX_CODE; l++) {
+                code = (code + count[l - 1]) << 1;
+                next[l] = code;
+            }
+            for (size_t i = 0; i < n; i++)
+                codes[i] = len[i] ? next[len[i]]++ : 0;
+        }
+    };
+}
+
+#endif // _ALG_HUFFMAN_CODE
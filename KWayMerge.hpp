@@ -0,0 +1,153 @@
+/*
+* K-way Merge with Loser Tree
+* Source - sorted run for LoserTree, requires:
+*   value_type, bool empty(), const value_type &front(), void advance()
+* IteratorRun<It> - Source over iterator range [first, last)
+* LoserTree<Source, Compare> - tournament tree merging k sorted runs
+*   internal nodes keep loser of their match, so replacing the winner
+*   takes exactly one comparison per tree level; equal elements come out
+*   in run order
+* Methods:
+*   1. size_t runs() - number of runs k
+*   2. bool empty() - all runs are exhausted
+*   3. const value_type &top() - smallest element
+*       complexity: O(1)
+*   4. value_type pop() - pop smallest element
+*       complexity: O(lg(k)) comparisons
+*   5. size_t pop_batch(value_type *out, size_t n) - pop up to n elements,
+*       return number of written elements
+*   6. OutIt pop_all(OutIt out) - merge everything into out
+* Nothing is allocated after construction.
+*/
+#ifndef _ALG_KWAY_MERGE
+#define _ALG_KWAY_MERGE
+
+#include <cstdint>
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+
+namespace alg {
+    template <typename It>
+    class IteratorRun {
+        It cur, last;
+    public:
+        using value_type = typename std::iterator_traits<It>::value_type;
+        IteratorRun(It first, It last) : cur(first), last(last) {}
+        bool empty() const {
+            return cur == last;
+        }
+        const value_type &front() const {
+            return *cur;
+        }
+        void advance() {
+            ++cur;
+        }
+    };
+
+    template <typename Source,
+              typename Compare = std::less<typename Source::value_type>>
+    class LoserTree {
+    public:
+        using value_type = typename Source::value_type;
+    private:
+        std::vector<Source> sources;
+        std::vector<uint32_t> tree; // tree[0] - winner, tree[1..k-1] - losers
+        size_t k;
+        Compare comp;
+
+        // run a wins over run b, one comparison: ties go to the lower run
+        bool beats(uint32_t a, uint32_t b) const {
+            if (sources[a].empty())
+                return false;
+            if (sources[b].empty())
+                return true;
+            if (a < b)
+                return !comp(sources[b].front(), sources[a].front());
+            return comp(sources[a].front(), sources[b].front());
+        }
+
+        void build() {
+            if (k == 0)
+                return;
+            // winners of subtrees, leaves are at k..2k-1
+            std::vector<uint32_t> win(2 * k);
+            for (size_t i = 0; i < k; i++)
+                win[k + i] = uint32_t(i);
+            for (size_t n = k - 1; n >= 1; n--) {
+                uint32_t a = win[2 * n], b = win[2 * n + 1];
+                if (beats(a, b)) {
+                    win[n] = a;
+                    tree[n] = b;
+                } else {
+                    win[n] = b;
+                    tree[n] = a;
+                }
+            }
+            tree[0] = k == 1 ? 0 : win[1];
+        }
+
+        void replay(uint32_t w) {
+            for (size_t n = (k + w) / 2; n >= 1; n /= 2) {
+                if (beats(tree[n], w))
+                    std::swap(tree[n], w);
+            }
+            tree[0] = w;
+        }
+
+    public:
+        explicit LoserTree(std::vector<Source> runs, Compare c = Compare())
+            : sources(std::move(runs)), tree(sources.size() ? sources.size() : 1),
+              k(sources.size()), comp(c) {
+            build();
+        }
+
+        size_t runs() const noexcept {
+            return k;
+        }
+        bool empty() const {
+            return k == 0 || sources[tree[0]].empty();
+        }
+        const value_type &top() const {
+            if (empty())
+                throw std::out_of_range("top of empty LoserTree");
+            return sources[tree[0]].front();
+        }
+
+        value_type pop() {
+            if (empty())
+                throw std::out_of_range("Pop from empty LoserTree");
+            uint32_t w = tree[0];
+            value_type res = sources[w].front();
+            sources[w].advance();
+            replay(w);
+            return res;
+        }
+
+        size_t pop_batch(value_type *out, size_t n) {
+            size_t i = 0;
+            for (; i < n && !empty(); i++) {
+                uint32_t w = tree[0];
+                out[i] = sources[w].front();
+                sources[w].advance();
+                replay(w);
+            }
+            return i;
+        }
+
+        template <typename OutIt>
+        OutIt pop_all(OutIt out) {
+            while (!empty()) {
+                uint32_t w = tree[0];
+                *out++ = sources[w].front();
+                sources[w].advance();
+                replay(w);
+            }
+            return out;
+        }
+    };
+}
+
+#endif // _ALG_KWAY_MERGE
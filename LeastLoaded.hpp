@@ -0,0 +1,308 @@
+/*
+* Least-loaded Server Selection
+* LoadBuckets - servers with small integer loads in [0, max_load], bucket
+*   i holds an intrusive list of servers with load i; a two-level bitmap
+*   marks non-empty buckets, so the min bucket is found without scanning
+*   empty ones; same id-as-handle interface as the heaps: insert returns
+*   the handle, get_min/pop/decrease_key/erase take it
+* Methods:
+*   1. LoadBuckets(uint32_t max_load = 1 << 20)
+*       throws std::invalid_argument if max_load is above 1 << 30
+*   2. size_t size() - number of servers, uint32_t max_load()
+*   3. uint32_t insert(uint32_t load = 0) - add server, return its id
+*       throws std::out_of_range if load > max_load
+*   4. void erase(uint32_t id) - remove server, its id may be reused
+*   5. uint32_t get_min() - id of a least loaded server
+*       complexity: O(1)
+*   6. uint32_t pop() - remove a least loaded server, return its id
+*   7. uint32_t get_load(uint32_t id), uint32_t min_load()
+*   8. void increase(uint32_t id), void decrease(uint32_t id)
+*   9. void set_load(uint32_t id, uint32_t load)
+*      void decrease_key(uint32_t id, uint32_t load) - load must not grow
+*       complexity: O(1), O(max_load / 4096) worst case to find the next
+*       min bucket when the min bucket empties
+*   10. uint32_t acquire() - least loaded server, its load is increased
+*      void release(uint32_t id) - same as decrease
+*   Servers with equal load are picked in round robin order.
+* ConcurrentLeastLoaded - fixed set of servers with atomic loads, acquire
+*   picks the less loaded of two distinct random servers (power of two
+*   choices), safe to call from many threads without locks
+* Methods:
+*   1. ConcurrentLeastLoaded(size_t servers)
+*   2. uint32_t acquire(), void release(uint32_t id)
+*   3. uint32_t get_load(uint32_t id)
+*   release and get_load throw std::out_of_range for an invalid id
+*/
+#ifndef _ALG_LEAST_LOADED
+#define _ALG_LEAST_LOADED
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <stdexcept>
+
+namespace alg {
+    class LoadBuckets {
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        struct Server {
+            uint32_t load;
+            uint32_t prev;
+            uint32_t next;
+            bool used;
+        };
+        struct Bucket {
+            uint32_t head = NIL;
+            uint32_t tail = NIL;
+        };
+
+        std::vector<Server> servers;
+        std::vector<uint32_t> free_ids;
+        std::vector<Bucket> buckets;
+        std::vector<uint64_t> bits;     // bit i: bucket i is non-empty
+        std::vector<uint64_t> summary;  // bit w: bits[w] != 0
+        uint32_t _max_load;
+        uint32_t min = 0;
+        size_t _size = 0;
+
+        void mark(uint32_t load) {
+            uint32_t w = load >> 6;
+            if (bits[w] == 0)
+                summary[w >> 6] |= uint64_t(1) << (w & 63);
+            bits[w] |= uint64_t(1) << (load & 63);
+        }
+        void clear(uint32_t load) {
+            uint32_t w = load >> 6;
+            bits[w] &= ~(uint64_t(1) << (load & 63));
+            if (bits[w] == 0)
+                summary[w >> 6] &= ~(uint64_t(1) << (w & 63));
+        }
+        // first non-empty bucket >= load, there must be one
+        uint32_t next_bucket(uint32_t load) const {
+            uint32_t w = load >> 6;
+            uint64_t m = bits[w] & (~uint64_t(0) << (load & 63));
+            if (m != 0)
+                return (w << 6) | uint32_t(__builtin_ctzll(m));
+            w++;
+            uint32_t s = w >> 6;
+            m = summary[s] & (~uint64_t(0) << (w & 63));
+            while (m == 0)
+                m = summary[++s];
+            w = (s << 6) | uint32_t(__builtin_ctzll(m));
+            return (w << 6) | uint32_t(__builtin_ctzll(bits[w]));
+        }
+
+        // append to tail, head is the next one to pick
+        void link(uint32_t x, uint32_t load) {
+            if (load >= buckets.size()) {
+                size_t n = std::max(size_t(load) + 1, 2 * buckets.size());
+                buckets.resize(std::min(n, size_t(_max_load) + 1));
+            }
+            Bucket &b = buckets[load];
+            if (b.head == NIL)
+                mark(load);
+            Server &s = servers[x];
+            s.load = load;
+            s.prev = b.tail;
+            s.next = NIL;
+            if (b.tail != NIL)
+                servers[b.tail].next = x;
+            else
+                b.head = x;
+            b.tail = x;
+        }
+        void unlink(uint32_t x) {
+            Server &s = servers[x];
+            Bucket &b = buckets[s.load];
+            if (s.prev != NIL)
+                servers[s.prev].next = s.next;
+            else
+                b.head = s.next;
+            if (s.next != NIL)
+                servers[s.next].prev = s.prev;
+            else
+                b.tail = s.prev;
+            if (b.head == NIL)
+                clear(s.load);
+        }
+        void fix_min() {
+            if (_size == 0)
+                min = 0;
+            else if (buckets[min].head == NIL)
+                min = next_bucket(min);
+        }
+        void check(uint32_t id) const {
+            if (id >= servers.size() || !servers[id].used)
+                throw std::out_of_range("LoadBuckets invalid server id");
+        }
+        void check_load(uint32_t load) const {
+            if (load > _max_load)
+                throw std::out_of_range("LoadBuckets load above max_load");
+        }
+
+    public:
+        explicit LoadBuckets(uint32_t max_load = 1 << 20) : _max_load(max_load) {
+            if (max_load > (1u << 30))
+                throw std::invalid_argument("LoadBuckets max_load above 1 << 30");
+            size_t words = size_t(max_load) / 64 + 1;
+            bits.assign(words, 0);
+            summary.assign(words / 64 + 1, 0);
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+        uint32_t max_load() const noexcept {
+            return _max_load;
+        }
+
+        uint32_t insert(uint32_t load = 0) {
+            check_load(load);
+            uint32_t x;
+            if (!free_ids.empty()) {
+                x = free_ids.back();
+                free_ids.pop_back();
+            } else {
+                x = uint32_t(servers.size());
+                servers.emplace_back();
+            }
+            servers[x].used = true;
+            link(x, load);
+            if (_size == 0 || load < min)
+                min = load;
+            _size++;
+            return x;
+        }
+
+        void erase(uint32_t id) {
+            check(id);
+            unlink(id);
+            servers[id].used = false;
+            free_ids.push_back(id);
+            _size--;
+            fix_min();
+        }
+
+        uint32_t get_min() const {
+            if (_size == 0)
+                throw std::out_of_range("get_min from empty LoadBuckets");
+            return buckets[min].head;
+        }
+        uint32_t pop() {
+            uint32_t x = get_min();
+            erase(x);
+            return x;
+        }
+        uint32_t min_load() const {
+            if (_size == 0)
+                throw std::out_of_range("min_load of empty LoadBuckets");
+            return min;
+        }
+        uint32_t get_load(uint32_t id) const {
+            check(id);
+            return servers[id].load;
+        }
+
+        void set_load(uint32_t id, uint32_t load) {
+            check(id);
+            check_load(load);
+            unlink(id);
+            link(id, load);
+            if (load < min)
+                min = load;
+            else
+                fix_min();
+        }
+        void decrease_key(uint32_t id, uint32_t load) {
+            check(id);
+            if (load > servers[id].load)
+                throw std::invalid_argument("LoadBuckets decrease_key to a higher load");
+            set_load(id, load);
+        }
+        void increase(uint32_t id) {
+            check(id);
+            set_load(id, servers[id].load + 1);
+        }
+        void decrease(uint32_t id) {
+            check(id);
+            if (servers[id].load == 0)
+                throw std::out_of_range("LoadBuckets load can't be negative");
+            set_load(id, servers[id].load - 1);
+        }
+
+        uint32_t acquire() {
+            uint32_t x = get_min();
+            increase(x);
+            return x;
+        }
+        void release(uint32_t id) {
+            decrease(id);
+        }
+    };
+
+    class ConcurrentLeastLoaded {
+        // one cache line per counter, accept loops hit them concurrently
+        struct alignas(64) Counter {
+            std::atomic<uint32_t> load{0};
+        };
+
+        std::unique_ptr<Counter[]> loads;
+        size_t n;
+
+        static uint64_t next_random() {
+            static thread_local uint64_t state =
+                std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+            // xorshift64*
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545f4914f6cdd1dull;
+        }
+
+    public:
+        explicit ConcurrentLeastLoaded(size_t servers) : loads(new Counter[servers]), n(servers) {
+            if (servers == 0)
+                throw std::invalid_argument("ConcurrentLeastLoaded needs servers");
+        }
+
+        size_t size() const noexcept {
+            return n;
+        }
+
+        uint32_t acquire() {
+            if (n == 1) {
+                loads[0].load.fetch_add(1, std::memory_order_relaxed);
+                return 0;
+            }
+            // b from the other n - 1 servers, so a != b
+            uint64_t r = next_random();
+            uint32_t a = uint32_t((r & 0xffffffffu) % n);
+            uint32_t b = uint32_t((r >> 32) % (n - 1));
+            if (b >= a)
+                b++;
+            if (loads[b].load.load(std::memory_order_relaxed)
+                < loads[a].load.load(std::memory_order_relaxed))
+                a = b;
+            loads[a].load.fetch_add(1, std::memory_order_relaxed);
+            return a;
+        }
+
+        void release(uint32_t id) {
+            if (id >= n)
+                throw std::out_of_range("ConcurrentLeastLoaded invalid server id");
+            loads[id].load.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        uint32_t get_load(uint32_t id) const {
+            if (id >= n)
+                throw std::out_of_range("ConcurrentLeastLoaded invalid server id");
+            return loads[id].load.load(std::memory_order_relaxed);
+        }
+    };
+}
+
+#endif // _ALG_LEAST_LOADED
@@ -0,0 +1,567 @@
+/*
+* Memory-mapped Persistent Fibonacci Heap
+* MappedFibHeap<T> - FibHeap with node storage in a memory-mapped file,
+*   nodes are linked by indices instead of shared_ptr, so reopening the
+*   file restores the heap in O(1) (plus page faults)
+*   T must be trivially copyable
+* MappedFibHeap<T>::Handle - node index, stays valid across reopen
+* Methods:
+*   1. MappedFibHeap(const std::string &path) - open heap file or create it,
+*       finish a sync() interrupted by a crash first
+*       throws std::runtime_error if file belongs to other T
+*   2. size_t size() - return heap size
+*   3. const T &get_min() - return min element, doesn't pop it
+*       complexity: O(1)
+*   4. Handle insert(const T &d) - insert new element to heap
+*       complexity: O(1), file grows by doubling
+*   5. const T &get_key(Handle h) - key of element
+*   6. void decrease_key(Handle h, const T &new_key)
+*       complexity: O(1) amortized
+*   7. void erase(Handle h) - remove element
+*       complexity: O(lg(N)) amortized
+*   8. T pop() - pop element from heap
+*       complexity: O(lg(N)) amortized
+*   9. void sync() - flush changes to disk, the file is a valid durability
+*       point after it returns
+*       complexity: O(changed pages), every page is written twice
+*   10. void close() - sync and unmap, also done by destructor
+* The file is mapped privately, so changes stay in memory until sync().
+* sync() writes changed pages to path.journal, commits it and only then
+* copies them into the file; a crash at any point reopens the heap in the
+* state of the last completed sync().
+*/
+#ifndef _ALG_MAPPED_FIB_HEAP
+#define _ALG_MAPPED_FIB_HEAP
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace alg {
+    template <typename T>
+    class MappedFibHeap {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "MappedFibHeap requires trivially copyable T");
+        static constexpr uint64_t MAGIC = 0x50414548424946ull; // "FIBHEAP"
+        static constexpr uint64_t JOURNAL_MAGIC = 0x4c4e524a424946ull; // "FIBJRNL"
+        static constexpr uint64_t COMMIT_MAGIC = 0x54494d4d4f43ull; // "COMMIT"
+        static constexpr uint32_t VERSION = 2;
+        static constexpr uint32_t NIL = UINT32_MAX;
+        static constexpr uint64_t INITIAL_CAPACITY = 1024;
+        static constexpr size_t MAX_DEGREE = 64;
+        static constexpr size_t JOURNAL_BUFFER = 1 << 20;
+
+        struct Header {
+            uint64_t magic;
+            uint32_t version;
+            uint32_t key_size;
+            uint64_t capacity;
+            uint64_t used;
+            uint64_t size;
+            uint32_t min;
+            uint32_t free_head;
+        };
+        struct Node {
+            T key;
+            uint32_t p;
+            uint32_t child;
+            uint32_t left;
+            uint32_t right;
+            uint32_t degree;
+            uint8_t mark;
+            uint8_t used;
+        };
+        // journal: JournalHeader, pages times {uint64_t offset, page bytes},
+        // uint64_t COMMIT_MAGIC; page bytes are cut at file_size
+        struct JournalHeader {
+            uint64_t magic;
+            uint64_t file_size;
+            uint64_t page_size;
+            uint64_t pages;
+        };
+        static constexpr size_t HEADER_SIZE = (sizeof(Header) + 63) / 64 * 64;
+
+        int fd = -1;
+        int jfd = -1;
+        void *base = nullptr;
+        size_t mapped = 0;
+        size_t page = 0;
+        Header *h = nullptr;
+        Node *nodes = nullptr;
+        std::vector<uint8_t> dirty;     // per page of the mapping
+        std::vector<size_t> changed;    // pages with dirty set
+
+        static size_t file_size(uint64_t capacity) {
+            return HEADER_SIZE + capacity * sizeof(Node);
+        }
+
+        static void write_all(int f, const void *p, size_t n, off_t off) {
+            const char *c = static_cast<const char *>(p);
+            while (n > 0) {
+                ssize_t r = ::pwrite(f, c, n, off);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    throw std::runtime_error("MappedFibHeap write failed");
+                c += r;
+                n -= size_t(r);
+                off += r;
+            }
+        }
+        // false if file ends first
+        static bool read_all(int f, void *p, size_t n, off_t off) {
+            char *c = static_cast<char *>(p);
+            while (n > 0) {
+                ssize_t r = ::pread(f, c, n, off);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r < 0)
+                    throw std::runtime_error("MappedFibHeap read failed");
+                if (r == 0)
+                    return false;
+                c += r;
+                n -= size_t(r);
+                off += r;
+            }
+            return true;
+        }
+        static void flush(int f) {
+            if (::fsync(f) != 0)
+                throw std::runtime_error("MappedFibHeap fsync failed");
+        }
+
+        void map(size_t bytes) {
+            void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+                throw std::runtime_error("MappedFibHeap mmap failed");
+            base = p;
+            mapped = bytes;
+            h = static_cast<Header *>(base);
+            nodes = reinterpret_cast<Node *>(static_cast<char *>(base) + HEADER_SIZE);
+            dirty.resize((bytes + page - 1) / page, 0);
+        }
+        void unmap() {
+            if (base)
+                munmap(base, mapped);
+            base = nullptr;
+            h = nullptr;
+            nodes = nullptr;
+        }
+
+        // file only grows, so a file longer than its header says is fine
+        // after a crash; changed pages are copied over to the new mapping
+        void grow() {
+            uint64_t capacity = h->capacity * 2;
+            if (capacity > NIL)
+                throw std::length_error("MappedFibHeap is full");
+            if (ftruncate(fd, off_t(file_size(capacity))) != 0)
+                throw std::runtime_error("MappedFibHeap can't grow file");
+            std::vector<char> saved(changed.size() * page);
+            for (size_t i = 0; i < changed.size(); i++)
+                std::memcpy(&saved[i * page], static_cast<char *>(base) + changed[i] * page,
+                            std::min(page, mapped - changed[i] * page));
+            unmap();
+            map(file_size(capacity));
+            for (size_t i = 0; i < changed.size(); i++)
+                std::memcpy(static_cast<char *>(base) + changed[i] * page, &saved[i * page],
+                            std::min(page, mapped - changed[i] * page));
+            h->capacity = capacity;
+        }
+
+        void mark(const void *p, size_t n) {
+            size_t off = size_t(static_cast<const char *>(p) - static_cast<char *>(base));
+            for (size_t i = off / page; i <= (off + n - 1) / page; i++) {
+                if (!dirty[i]) {
+                    dirty[i] = 1;
+                    changed.push_back(i);
+                }
+            }
+        }
+        // header changes with every operation
+        void touch() {
+            mark(h, sizeof(Header));
+        }
+        // node for writing
+        Node &w(uint32_t x) {
+            mark(nodes + x, sizeof(Node));
+            return nodes[x];
+        }
+
+        // redo a committed journal, drop an incomplete one
+        void recover() {
+            JournalHeader jh;
+            uint64_t commit = 0;
+            if (read_all(jfd, &jh, sizeof(jh), 0) && jh.magic == JOURNAL_MAGIC
+                && jh.page_size > 0 && jh.page_size <= (1u << 30)) {
+                off_t off = sizeof(jh);
+                off_t end = off;
+                bool ok = true;
+                for (uint64_t i = 0; ok && i < jh.pages; i++) {
+                    uint64_t at;
+                    ok = read_all(jfd, &at, sizeof(at), end) && at < jh.file_size
+                         && at % jh.page_size == 0;
+                    if (ok)
+                        end += off_t(sizeof(at) + std::min<uint64_t>(jh.page_size, jh.file_size - at));
+                }
+                if (ok && read_all(jfd, &commit, sizeof(commit), end) && commit == COMMIT_MAGIC) {
+                    if (ftruncate(fd, off_t(jh.file_size)) != 0)
+                        throw std::runtime_error("MappedFibHeap can't size file");
+                    std::vector<char> buf(jh.page_size);
+                    for (uint64_t i = 0; i < jh.pages; i++) {
+                        uint64_t at;
+                        read_all(jfd, &at, sizeof(at), off);
+                        size_t n = size_t(std::min<uint64_t>(jh.page_size, jh.file_size - at));
+                        if (!read_all(jfd, buf.data(), n, off + off_t(sizeof(at))))
+                            throw std::runtime_error("MappedFibHeap journal read failed");
+                        write_all(fd, buf.data(), n, off_t(at));
+                        off += off_t(sizeof(at) + n);
+                    }
+                    flush(fd);
+                }
+            }
+            if (ftruncate(jfd, 0) != 0)
+                throw std::runtime_error("MappedFibHeap can't reset journal");
+            flush(jfd);
+        }
+
+        uint32_t alloc_node() {
+            uint32_t x;
+            if (h->free_head != NIL) {
+                x = h->free_head;
+                h->free_head = nodes[x].right;
+            } else {
+                if (h->used == h->capacity)
+                    grow();
+                x = uint32_t(h->used++);
+            }
+            return x;
+        }
+        void free_node(uint32_t x) {
+            Node &n = w(x);
+            n.used = 0;
+            n.right = h->free_head;
+            h->free_head = x;
+        }
+
+        bool less(uint32_t a, uint32_t b) const {
+            return nodes[a].key < nodes[b].key;
+        }
+
+        // add x to root list
+        void insert_root(uint32_t x) {
+            Node &n = w(x);
+            n.p = NIL;
+            if (h->min == NIL) {
+                n.left = n.right = x;
+                h->min = x;
+                return;
+            }
+            uint32_t m = h->min;
+            uint32_t l = nodes[m].left;
+            w(l).right = x;
+            n.left = l;
+            n.right = m;
+            w(m).left = x;
+            if (less(x, m))
+                h->min = x;
+        }
+        void remove_from_list(uint32_t x) {
+            w(nodes[x].left).right = nodes[x].right;
+            w(nodes[x].right).left = nodes[x].left;
+            w(x).left = nodes[x].right = x;
+        }
+
+        void link(uint32_t y, uint32_t x) {
+            remove_from_list(y);
+            uint32_t c = nodes[x].child;
+            if (c == NIL) {
+                w(x).child = y;
+            } else {
+                uint32_t r = nodes[c].right;
+                w(c).right = y;
+                w(y).left = c;
+                w(r).left = y;
+                nodes[y].right = r;
+            }
+            w(y).p = x;
+            w(x).degree++;
+            nodes[y].mark = 0;
+        }
+
+        void consolidate() {
+            uint32_t A[MAX_DEGREE];
+            for (auto &a : A)
+                a = NIL;
+            uint32_t start = h->min;
+            if (start == NIL)
+                return;
+            // break root list into a chain, it is rebuilt below
+            uint32_t last = nodes[start].left;
+            w(last).right = NIL;
+            h->min = NIL;
+            for (uint32_t v = start; v != NIL;) {
+                uint32_t next = nodes[v].right;
+                uint32_t x = v;
+                w(x).left = nodes[x].right = x;
+                uint32_t d = nodes[x].degree;
+                while (A[d] != NIL) {
+                    uint32_t y = A[d];
+                    if (less(y, x))
+                        std::swap(x, y);
+                    link(y, x);
+                    A[d] = NIL;
+                    d++;
+                }
+                A[d] = x;
+                v = next;
+            }
+            for (auto a : A) {
+                if (a != NIL)
+                    insert_root(a);
+            }
+        }
+
+        void cut(uint32_t x, uint32_t y) {
+            if (nodes[x].right == x)
+                w(y).child = NIL;
+            else if (nodes[y].child == x)
+                w(y).child = nodes[x].right;
+            remove_from_list(x);
+            w(y).degree--;
+            w(x).mark = 0;
+            insert_root(x);
+        }
+        void cascading_cut(uint32_t y) {
+            for (uint32_t z = nodes[y].p; z != NIL; y = z, z = nodes[y].p) {
+                if (!nodes[y].mark) {
+                    w(y).mark = 1;
+                    return;
+                }
+                cut(y, z);
+            }
+        }
+
+        void check(uint32_t x) const {
+            if (x >= h->used || !nodes[x].used)
+                throw std::out_of_range("MappedFibHeap invalid handle");
+        }
+
+        // remove min from root list, splice its children in
+        uint32_t extract_min() {
+            uint32_t z = h->min;
+            uint32_t c = nodes[z].child;
+            while (c != NIL) {
+                uint32_t next = nodes[c].right == c ? NIL : nodes[c].right;
+                remove_from_list(c);
+                insert_root(c);
+                c = next;
+            }
+            w(z).child = NIL;
+            if (nodes[z].right == z) {
+                h->min = NIL;
+            } else {
+                h->min = nodes[z].right;
+                remove_from_list(z);
+                consolidate();
+            }
+            h->size--;
+            return z;
+        }
+
+        void release() {
+            unmap();
+            if (fd >= 0)
+                ::close(fd);
+            if (jfd >= 0)
+                ::close(jfd);
+            fd = jfd = -1;
+        }
+
+    public:
+        using Handle = uint32_t;
+
+        explicit MappedFibHeap(const std::string &path) {
+            page = size_t(sysconf(_SC_PAGESIZE));
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0)
+                throw std::runtime_error("MappedFibHeap can't open " + path);
+            jfd = ::open((path + ".journal").c_str(), O_RDWR | O_CREAT, 0644);
+            if (jfd < 0) {
+                release();
+                throw std::runtime_error("MappedFibHeap can't open " + path + ".journal");
+            }
+            try {
+                recover();
+                struct stat st;
+                if (fstat(fd, &st) != 0)
+                    throw std::runtime_error("MappedFibHeap can't stat " + path);
+                Header hdr{};
+                if (size_t(st.st_size) >= HEADER_SIZE && !read_all(fd, &hdr, sizeof(hdr), 0))
+                    throw std::runtime_error("MappedFibHeap can't read " + path);
+                // empty file, or a crash before the first sync
+                if (hdr.magic == 0) {
+                    if (ftruncate(fd, off_t(file_size(INITIAL_CAPACITY))) != 0)
+                        throw std::runtime_error("MappedFibHeap can't size " + path);
+                    map(file_size(INITIAL_CAPACITY));
+                    *h = Header{MAGIC, VERSION, uint32_t(sizeof(T)), INITIAL_CAPACITY,
+                                0, 0, NIL, NIL};
+                    touch();
+                    sync();
+                    return;
+                }
+                if (hdr.magic != MAGIC || hdr.version != VERSION
+                    || hdr.key_size != sizeof(T) || hdr.capacity > NIL
+                    || file_size(hdr.capacity) > size_t(st.st_size))
+                    throw std::runtime_error("MappedFibHeap bad file " + path);
+                // grown but not synced before a crash
+                if (file_size(hdr.capacity) < size_t(st.st_size)
+                    && ftruncate(fd, off_t(file_size(hdr.capacity))) != 0)
+                    throw std::runtime_error("MappedFibHeap can't size " + path);
+                map(file_size(hdr.capacity));
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+        MappedFibHeap(const MappedFibHeap &) = delete;
+        MappedFibHeap &operator = (const MappedFibHeap &) = delete;
+        ~MappedFibHeap() {
+            try {
+                close();
+            } catch (...) {
+                release();
+            }
+        }
+
+        size_t size() const noexcept {
+            return h ? size_t(h->size) : 0;
+        }
+
+        const T &get_min() const {
+            if (!h || h->min == NIL)
+                throw std::out_of_range("get_min from empty MappedFibHeap");
+            return nodes[h->min].key;
+        }
+        const T &get_key(Handle x) const {
+            check(x);
+            return nodes[x].key;
+        }
+
+        Handle insert(const T &key) {
+            touch();
+            uint32_t x = alloc_node();
+            Node &n = w(x);
+            n.key = key;
+            n.child = NIL;
+            n.degree = 0;
+            n.mark = 0;
+            n.used = 1;
+            insert_root(x);
+            h->size++;
+            return x;
+        }
+
+        void decrease_key(Handle x, const T &new_key) {
+            check(x);
+            if (nodes[x].key < new_key)
+                throw std::out_of_range("MappedFibHeap key can't be increased");
+            touch();
+            w(x).key = new_key;
+            uint32_t y = nodes[x].p;
+            if (y != NIL && less(x, y)) {
+                cut(x, y);
+                cascading_cut(y);
+            }
+            if (less(x, h->min))
+                h->min = x;
+        }
+
+        void erase(Handle x) {
+            check(x);
+            touch();
+            uint32_t y = nodes[x].p;
+            if (y != NIL) {
+                cut(x, y);
+                cascading_cut(y);
+            }
+            h->min = x;
+            free_node(extract_min());
+        }
+
+        T pop() {
+            if (!h || h->min == NIL)
+                throw std::out_of_range("Pop from empty MappedFibHeap");
+            touch();
+            uint32_t z = extract_min();
+            T res = nodes[z].key;
+            free_node(z);
+            return res;
+        }
+
+        void sync() {
+            if (!h || changed.empty())
+                return;
+            // 1. journal with the changed pages, made durable before commit
+            JournalHeader jh{JOURNAL_MAGIC, uint64_t(mapped), uint64_t(page),
+                             uint64_t(changed.size())};
+            std::vector<char> buf;
+            buf.reserve(JOURNAL_BUFFER + page + sizeof(uint64_t));
+            off_t off = 0;
+            auto append = [&](const void *p, size_t n) {
+                buf.insert(buf.end(), static_cast<const char *>(p), static_cast<const char *>(p) + n);
+                if (buf.size() >= JOURNAL_BUFFER) {
+                    write_all(jfd, buf.data(), buf.size(), off);
+                    off += off_t(buf.size());
+                    buf.clear();
+                }
+            };
+            append(&jh, sizeof(jh));
+            for (size_t i : changed) {
+                uint64_t at = uint64_t(i) * page;
+                append(&at, sizeof(at));
+                append(static_cast<char *>(base) + at, std::min<size_t>(page, mapped - at));
+            }
+            write_all(jfd, buf.data(), buf.size(), off);
+            off += off_t(buf.size());
+            flush(jfd);
+            // 2. commit record
+            write_all(jfd, &COMMIT_MAGIC, sizeof(COMMIT_MAGIC), off);
+            flush(jfd);
+            // 3. pages go to the file, a crash from here on redoes them on open
+            for (size_t i : changed) {
+                size_t at = i * page;
+                write_all(fd, static_cast<char *>(base) + at, std::min(page, mapped - at), off_t(at));
+            }
+            flush(fd);
+            if (ftruncate(jfd, 0) != 0)
+                throw std::runtime_error("MappedFibHeap can't reset journal");
+            flush(jfd);
+            // 4. drop private copies, pages are read back from the file
+            for (size_t i : changed) {
+                madvise(static_cast<char *>(base) + i * page, std::min(page, mapped - i * page),
+                        MADV_DONTNEED);
+                dirty[i] = 0;
+            }
+            changed.clear();
+        }
+
+        void close() {
+            if (fd < 0)
+                return;
+            sync();
+            release();
+        }
+    };
+}
+
+#endif // _ALG_MAPPED_FIB_HEAP
@@ -0,0 +1,251 @@
+/*
+* Min-max Heap Implementation
+* MinMaxHeap<T, Compare> - double-ended priority queue, array heap where
+*   even levels are ordered as min heap and odd levels as max heap,
+*   keys live in one contiguous array
+* MinMaxHeap<T>::Handle - returned by insert, required for erase/update
+* Methods:
+*   1. size_t size(), bool empty()
+*   2. const T &get_min(), const T &get_max() - peek both ends
+*       complexity: O(1)
+*   3. Handle insert(const T &d) - insert new element
+*       complexity: O(lg(N))
+*   4. T pop_min(), T pop_max() - pop element from either end
+*       complexity: O(lg(N))
+*   5. bool erase(const Handle &h) - remove element, return false if it
+*       was already removed
+*       complexity: O(lg(N))
+*   6. bool update(const Handle &h, const T &new_key) - change key to
+*       either direction, return false if element was removed
+*       complexity: O(lg(N))
+*   7. bool contains(const Handle &h), const T &get_key(const Handle &h)
+*   8. void reserve(size_t n)
+*   9. void for_each(F &&f) const - f(key) for every element, array order
+*       complexity: O(N)
+*/
+#ifndef _ALG_MIN_MAX_HEAP
+#define _ALG_MIN_MAX_HEAP
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <functional>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T, typename Compare = std::less<T>>
+    class MinMaxHeap {
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        struct Slot {
+            T key;
+            uint32_t id;
+        };
+
+        std::vector<Slot> a;
+        std::vector<uint32_t> pos;  // handle id -> index in a, NIL if free
+        std::vector<uint32_t> gens;
+        std::vector<uint32_t> free_ids;
+        Compare comp;
+
+        static bool min_level(size_t i) noexcept {
+            // level of i is floor(log2(i + 1))
+            return ((63 - __builtin_clzll(uint64_t(i) + 1)) & 1) == 0;
+        }
+        bool less(size_t i, size_t j) const {
+            return comp(a[i].key, a[j].key);
+        }
+        void swap_slots(size_t i, size_t j) {
+            std::swap(a[i], a[j]);
+            pos[a[i].id] = uint32_t(i);
+            pos[a[j].id] = uint32_t(j);
+        }
+
+        // MIN: walk up grandparents while smaller (larger when !MIN)
+        template <bool MIN>
+        size_t bubble_up_level(size_t i) {
+            while (i >= 3) {
+                size_t g = ((i - 1) / 2 - 1) / 2;
+                if (MIN ? !less(i, g) : !less(g, i))
+                    break;
+                swap_slots(i, g);
+                i = g;
+            }
+            return i;
+        }
+        void bubble_up(size_t i) {
+            if (i == 0)
+                return;
+            size_t p = (i - 1) / 2;
+            if (min_level(i)) {
+                if (less(p, i)) {
+                    swap_slots(i, p);
+                    bubble_up_level<false>(p);
+                } else {
+                    bubble_up_level<true>(i);
+                }
+            } else {
+                if (less(i, p)) {
+                    swap_slots(i, p);
+                    bubble_up_level<true>(p);
+                } else {
+                    bubble_up_level<false>(i);
+                }
+            }
+        }
+
+        // MIN: smallest of children and grandchildren (largest when !MIN)
+        template <bool MIN>
+        void trickle_down_level(size_t i) {
+            size_t n = a.size();
+            for (;;) {
+                size_t c = 2 * i + 1;
+                if (c >= n)
+                    return;
+                size_t m = c;
+                size_t last = std::min(4 * i + 6, n - 1);
+                if (c + 1 < n && (MIN ? less(c + 1, m) : less(m, c + 1)))
+                    m = c + 1;
+                for (size_t k = 4 * i + 3; k <= last; k++) {
+                    if (MIN ? less(k, m) : less(m, k))
+                        m = k;
+                }
+                if (MIN ? !less(m, i) : !less(i, m))
+                    return;
+                swap_slots(i, m);
+                if (m <= c + 1)
+                    return; // child, nothing below it is affected
+                size_t p = (m - 1) / 2;
+                if (MIN ? less(p, m) : less(m, p))
+                    swap_slots(m, p);
+                i = m;
+            }
+        }
+        void trickle_down(size_t i) {
+            if (min_level(i))
+                trickle_down_level<true>(i);
+            else
+                trickle_down_level<false>(i);
+        }
+
+        size_t max_index() const {
+            if (a.size() < 3)
+                return a.size() - 1;
+            return less(1, 2) ? 2 : 1;
+        }
+
+        // remove element at index i
+        T remove_at(size_t i) {
+            uint32_t id = a[i].id;
+            T res = std::move(a[i].key);
+            pos[id] = NIL;
+            gens[id]++;
+            free_ids.push_back(id);
+            if (i + 1 != a.size()) {
+                a[i] = std::move(a.back());
+                pos[a[i].id] = uint32_t(i);
+                a.pop_back();
+                uint32_t moved = a[i].id;
+                trickle_down(i);
+                bubble_up(pos[moved]);
+            } else {
+                a.pop_back();
+            }
+            return res;
+        }
+
+    public:
+        struct Handle {
+            uint32_t idx = NIL;
+            uint32_t gen = 0;
+        };
+
+        explicit MinMaxHeap(Compare c = Compare()) : comp(c) {
+        }
+
+        size_t size() const noexcept {
+            return a.size();
+        }
+        bool empty() const noexcept {
+            return a.empty();
+        }
+        void reserve(size_t n) {
+            a.reserve(n);
+            pos.reserve(n);
+            gens.reserve(n);
+        }
+
+        const T &get_min() const {
+            if (a.empty())
+                throw std::out_of_range("get_min from empty MinMaxHeap");
+            return a[0].key;
+        }
+        const T &get_max() const {
+            if (a.empty())
+                throw std::out_of_range("get_max from empty MinMaxHeap");
+            return a[max_index()].key;
+        }
+
+        Handle insert(const T &d) {
+            uint32_t id;
+            if (!free_ids.empty()) {
+                id = free_ids.back();
+                free_ids.pop_back();
+            } else {
+                id = uint32_t(pos.size());
+                pos.push_back(NIL);
+                gens.push_back(0);
+            }
+            pos[id] = uint32_t(a.size());
+            a.push_back(Slot{d, id});
+            bubble_up(a.size() - 1);
+            return Handle{id, gens[id]};
+        }
+
+        T pop_min() {
+            if (a.empty())
+                throw std::out_of_range("Pop from empty MinMaxHeap");
+            return remove_at(0);
+        }
+        T pop_max() {
+            if (a.empty())
+                throw std::out_of_range("Pop from empty MinMaxHeap");
+            return remove_at(max_index());
+        }
+
+        bool contains(const Handle &h) const noexcept {
+            return h.idx < pos.size() && pos[h.idx] != NIL && gens[h.idx] == h.gen;
+        }
+        const T &get_key(const Handle &h) const {
+            if (!contains(h))
+                throw std::out_of_range("MinMaxHeap invalid handle");
+            return a[pos[h.idx]].key;
+        }
+
+        bool erase(const Handle &h) {
+            if (!contains(h))
+                return false;
+            remove_at(pos[h.idx]);
+            return true;
+        }
+
+        bool update(const Handle &h, const T &new_key) {
+            if (!contains(h))
+                return false;
+            size_t i = pos[h.idx];
+            a[i].key = new_key;
+            trickle_down(i);
+            bubble_up(pos[h.idx]);
+            return true;
+        }
+
+        template <typename F>
+        void for_each(F &&f) const {
+            for (const Slot &s : a)
+                f(s.key);
+        }
+    };
+}
+
+#endif // _ALG_MIN_MAX_HEAP
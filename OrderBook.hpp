@@ -0,0 +1,296 @@
+/*
+* Price-time Priority Order Book
+* OrderBook<Price, Qty> - limit order book, per side an addressable
+*   MinMaxHeap of price levels, FIFO list of orders inside each level,
+*   order id -> order index hash map
+*   incoming orders match against the opposite side first (best price,
+*   then arrival time), remainder rests in the book
+* Methods:
+*   1. size_t size() - resting orders, size_t levels(Side s)
+*   2. bool best(Side s, Price &price, Qty &qty) - best level of side
+*       complexity: O(1)
+*   3. Qty limit(OrderId id, Side s, Price price, Qty qty[, OnFill on_fill])
+*       match, then rest remainder; return resting quantity;
+*       on_fill(maker_id, taker_id, price, qty) for every fill, in fill
+*       order after the order has been matched and rested, so it may
+*       use the book, also to add or cancel orders
+*       throws std::invalid_argument for duplicate id or zero qty
+*       complexity: O(1) per fill and for resting on existing level,
+*       O(lg(levels)) for new or emptied level
+*   4. Qty market(OrderId id, Side s, Qty qty, OnFill on_fill) - match
+*       without price limit, nothing rests; return filled quantity
+*   5. bool cancel(OrderId id) - remove resting order
+*       complexity: O(1), O(lg(levels)) if its level becomes empty
+*   6. bool reduce(OrderId id, Qty new_qty) - lower quantity keeping
+*       time priority, new_qty == 0 cancels
+*       complexity: O(1)
+*   7. bool replace(OrderId id, Price price, Qty qty[, OnFill on_fill])
+*       cancel and re-add with the same id as limit(), loses time priority
+*   8. Qty level_qty(Side s, Price price) - total quantity at price
+*/
+#ifndef _ALG_ORDER_BOOK
+#define _ALG_ORDER_BOOK
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
+#include "MinMaxHeap.hpp"
+
+namespace alg {
+    template <typename Price = int64_t, typename Qty = uint64_t>
+    class OrderBook {
+    public:
+        using OrderId = uint64_t;
+        enum Side : uint8_t {
+            BID = 0,
+            ASK = 1
+        };
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        // min side of heap is best price: lowest ask, highest bid
+        struct PriceOrder {
+            bool bid;
+            bool operator () (const Price &a, const Price &b) const {
+                return bid ? b < a : a < b;
+            }
+        };
+        using LevelHeap = MinMaxHeap<Price, PriceOrder>;
+
+        struct Order {
+            OrderId id;
+            Qty qty;
+            uint32_t level;
+            uint32_t prev;
+            uint32_t next;
+        };
+        struct Level {
+            Price price;
+            Qty qty;
+            uint32_t head;
+            uint32_t tail;
+            typename LevelHeap::Handle handle;
+            Side side;
+        };
+        struct SideBook {
+            LevelHeap heap;
+            std::unordered_map<Price, uint32_t> by_price;
+            explicit SideBook(bool bid) : heap(PriceOrder{bid}) {
+            }
+        };
+
+        std::vector<Order> orders;
+        std::vector<uint32_t> free_orders;
+        std::vector<Level> levels_pool;
+        std::vector<uint32_t> free_levels;
+        std::unordered_map<OrderId, uint32_t> index;
+        SideBook sides[2] = {SideBook(true), SideBook(false)};
+        struct Fill {
+            OrderId maker;
+            Price price;
+            Qty qty;
+        };
+        std::vector<Fill> fills;        // of the current match
+        std::vector<Fill> spare;
+
+        uint32_t level_of(Side s, Price price) {
+            SideBook &b = sides[s];
+            auto it = b.by_price.find(price);
+            if (it != b.by_price.end())
+                return it->second;
+            uint32_t l;
+            if (!free_levels.empty()) {
+                l = free_levels.back();
+                free_levels.pop_back();
+            } else {
+                l = uint32_t(levels_pool.size());
+                levels_pool.emplace_back();
+            }
+            Level &lv = levels_pool[l];
+            lv.price = price;
+            lv.qty = 0;
+            lv.head = lv.tail = NIL;
+            lv.side = s;
+            lv.handle = b.heap.insert(price);
+            b.by_price.emplace(price, l);
+            return l;
+        }
+        void drop_level(uint32_t l) {
+            Level &lv = levels_pool[l];
+            SideBook &b = sides[lv.side];
+            b.heap.erase(lv.handle);
+            b.by_price.erase(lv.price);
+            free_levels.push_back(l);
+        }
+
+        void rest(OrderId id, Side s, Price price, Qty qty) {
+            uint32_t l = level_of(s, price);
+            uint32_t x;
+            if (!free_orders.empty()) {
+                x = free_orders.back();
+                free_orders.pop_back();
+            } else {
+                x = uint32_t(orders.size());
+                orders.emplace_back();
+            }
+            Level &lv = levels_pool[l];
+            orders[x] = Order{id, qty, l, lv.tail, NIL};
+            if (lv.tail != NIL)
+                orders[lv.tail].next = x;
+            else
+                lv.head = x;
+            lv.tail = x;
+            lv.qty += qty;
+            index.emplace(id, x);
+        }
+
+        // unlink order x, drop its level if it becomes empty
+        void remove(uint32_t x) {
+            Order &o = orders[x];
+            Level &lv = levels_pool[o.level];
+            if (o.prev != NIL)
+                orders[o.prev].next = o.next;
+            else
+                lv.head = o.next;
+            if (o.next != NIL)
+                orders[o.next].prev = o.prev;
+            else
+                lv.tail = o.prev;
+            lv.qty -= o.qty;
+            index.erase(o.id);
+            free_orders.push_back(x);
+            if (lv.head == NIL)
+                drop_level(o.level);
+        }
+
+        // collect fills, the book is changed while they are made
+        Qty match(Side s, bool limited, Price price, Qty qty) {
+            SideBook &opp = sides[s == BID ? ASK : BID];
+            Qty filled = 0;
+            while (qty > 0 && !opp.heap.empty()) {
+                Price best = opp.heap.get_min();
+                if (limited && (s == BID ? price < best : best < price))
+                    break;
+                uint32_t l = opp.by_price.find(best)->second;
+                while (qty > 0 && levels_pool[l].head != NIL) {
+                    uint32_t x = levels_pool[l].head;
+                    Order &o = orders[x];
+                    Qty q = o.qty < qty ? o.qty : qty;
+                    o.qty -= q;
+                    levels_pool[l].qty -= q;
+                    qty -= q;
+                    filled += q;
+                    fills.push_back(Fill{o.id, best, q});
+                    if (o.qty == 0)
+                        remove(x); // may drop level l
+                }
+            }
+            return filled;
+        }
+
+        // run callbacks of collected fills, they may match again
+        template <typename OnFill>
+        void report(OrderId taker, OnFill &on_fill) {
+            if (fills.empty())
+                return;
+            std::vector<Fill> done;
+            done.swap(spare);
+            done.swap(fills);
+            for (const Fill &f : done)
+                on_fill(f.maker, taker, f.price, f.qty);
+            done.clear();
+            spare.swap(done);
+        }
+
+    public:
+        size_t size() const noexcept {
+            return index.size();
+        }
+        size_t levels(Side s) const noexcept {
+            return sides[s].heap.size();
+        }
+
+        bool best(Side s, Price &price, Qty &qty) const {
+            const SideBook &b = sides[s];
+            if (b.heap.empty())
+                return false;
+            price = b.heap.get_min();
+            qty = levels_pool[b.by_price.find(price)->second].qty;
+            return true;
+        }
+
+        Qty level_qty(Side s, Price price) const {
+            const SideBook &b = sides[s];
+            auto it = b.by_price.find(price);
+            return it == b.by_price.end() ? Qty(0) : levels_pool[it->second].qty;
+        }
+
+        template <typename OnFill>
+        Qty limit(OrderId id, Side s, Price price, Qty qty, OnFill on_fill) {
+            if (qty == 0)
+                throw std::invalid_argument("OrderBook order quantity must be positive");
+            if (index.count(id))
+                throw std::invalid_argument("OrderBook duplicate order id");
+            qty -= match(s, true, price, qty);
+            if (qty > 0)
+                rest(id, s, price, qty);
+            report(id, on_fill);
+            return qty;
+        }
+        Qty limit(OrderId id, Side s, Price price, Qty qty) {
+            return limit(id, s, price, qty, [](OrderId, OrderId, Price, Qty) {});
+        }
+
+        template <typename OnFill>
+        Qty market(OrderId id, Side s, Qty qty, OnFill on_fill) {
+            Qty filled = match(s, false, Price(), qty);
+            report(id, on_fill);
+            return filled;
+        }
+
+        bool cancel(OrderId id) {
+            auto it = index.find(id);
+            if (it == index.end())
+                return false;
+            remove(it->second);
+            return true;
+        }
+
+        bool reduce(OrderId id, Qty new_qty) {
+            auto it = index.find(id);
+            if (it == index.end())
+                return false;
+            Order &o = orders[it->second];
+            if (new_qty > o.qty)
+                throw std::invalid_argument("OrderBook reduce can't increase quantity");
+            if (new_qty == 0) {
+                remove(it->second);
+                return true;
+            }
+            levels_pool[o.level].qty -= o.qty - new_qty;
+            o.qty = new_qty;
+            return true;
+        }
+
+        template <typename OnFill>
+        bool replace(OrderId id, Price price, Qty qty, OnFill on_fill) {
+            auto it = index.find(id);
+            if (it == index.end())
+                return false;
+            if (qty == 0)
+                throw std::invalid_argument("OrderBook order quantity must be positive");
+            Side s = levels_pool[orders[it->second].level].side;
+            remove(it->second);
+            limit(id, s, price, qty, on_fill);
+            return true;
+        }
+        bool replace(OrderId id, Price price, Qty qty) {
+            return replace(id, price, qty, [](OrderId, OrderId, Price, Qty) {});
+        }
+    };
+}
+
+#endif // _ALG_ORDER_BOOK
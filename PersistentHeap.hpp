@@ -0,0 +1,152 @@
+/*
+* Persistent Leftist Heap Implementation
+* PersistentHeap<T, Compare> - fully persistent meldable min heap
+*   nodes are immutable and shared between versions, copying a heap is
+*   O(1) and gives an independent version; insert/pop/add_heap change only
+*   this version and allocate O(lg(N)) new nodes along the right spine
+*   versions may be read and changed from different threads as long as
+*   every PersistentHeap object is used by one thread at a time
+* Methods:
+*   1. size_t size(), bool empty()
+*   2. const T &get_min() - return min element, doesn't pop it
+*       complexity: O(1)
+*   3. void insert(const T &d) - insert new element to heap
+*       complexity: O(lg(N))
+*   4. void add_heap(const PersistentHeap &H2) - merge H2 into heap,
+*       H2 stays valid
+*       complexity: O(lg(N))
+*   5. T pop() - pop element from heap
+*       complexity: O(lg(N))
+*   6. PersistentHeap inserted(const T &d), PersistentHeap popped(),
+*      PersistentHeap merged(const PersistentHeap &H2) - new version,
+*       this one is unchanged
+*/
+#ifndef _ALG_PERSISTENT_HEAP
+#define _ALG_PERSISTENT_HEAP
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T, typename Compare = std::less<T>>
+    class PersistentHeap {
+        struct Node;
+        using NodePtr = std::shared_ptr<const Node>;
+
+        struct Node {
+            T key;
+            uint32_t rank; // length of right spine
+            NodePtr left;
+            NodePtr right;
+
+            Node(const T &k, NodePtr a, NodePtr b) : key(k), left(std::move(a)), right(std::move(b)) {
+                if (rank_of(left) < rank_of(right))
+                    std::swap(left, right);
+                rank = rank_of(right) + 1;
+            }
+            static bool unique(const NodePtr &n) noexcept {
+                return n && n.use_count() == 1;
+            }
+            // free the nodes only n owns; rotations move its left subtrees
+            // into the right chain, a node is freed once it has no left
+            // child, so no recursion and no allocation
+            static void release(NodePtr n) noexcept {
+                while (unique(n)) {
+                    Node &m = const_cast<Node &>(*n);
+                    if (unique(m.left)) {
+                        NodePtr l = std::move(m.left);
+                        Node &ml = const_cast<Node &>(*l);
+                        m.left = std::move(ml.right);
+                        ml.right = std::move(n);
+                        n = std::move(l);
+                    } else {
+                        m.left.reset();     // shared or empty, only drops a count
+                        NodePtr r = std::move(m.right);
+                        n = std::move(r);
+                    }
+                }
+            }
+            // left spine can be O(N) long
+            ~Node() {
+                release(std::move(left));
+                release(std::move(right));
+            }
+        };
+
+        NodePtr root;
+        size_t _size = 0;
+        Compare comp;
+
+        static uint32_t rank_of(const NodePtr &n) noexcept {
+            return n ? n->rank : 0;
+        }
+
+        // depth is bounded by the sum of right spine lengths, O(lg(N))
+        NodePtr merge(const NodePtr &a, const NodePtr &b) const {
+            if (!a)
+                return b;
+            if (!b)
+                return a;
+            if (comp(b->key, a->key))
+                return std::make_shared<Node>(b->key, b->left, merge(a, b->right));
+            return std::make_shared<Node>(a->key, a->left, merge(a->right, b));
+        }
+
+    public:
+        explicit PersistentHeap(Compare c = Compare()) : comp(c) {
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+        bool empty() const noexcept {
+            return _size == 0;
+        }
+
+        const T &get_min() const {
+            if (!root)
+                throw std::out_of_range("get_min from empty PersistentHeap");
+            return root->key;
+        }
+
+        void insert(const T &d) {
+            root = merge(root, std::make_shared<Node>(d, nullptr, nullptr));
+            _size++;
+        }
+
+        void add_heap(const PersistentHeap &H2) {
+            root = merge(root, H2.root);
+            _size += H2._size;
+        }
+
+        T pop() {
+            if (!root)
+                throw std::out_of_range("Pop from empty PersistentHeap");
+            T res = root->key;
+            root = merge(root->left, root->right);
+            _size--;
+            return res;
+        }
+
+        PersistentHeap inserted(const T &d) const {
+            PersistentHeap h(*this);
+            h.insert(d);
+            return h;
+        }
+        PersistentHeap popped() const {
+            PersistentHeap h(*this);
+            h.pop();
+            return h;
+        }
+        PersistentHeap merged(const PersistentHeap &H2) const {
+            PersistentHeap h(*this);
+            h.add_heap(H2);
+            return h;
+        }
+    };
+}
+
+#endif // _ALG_PERSISTENT_HEAP
@@ -0,0 +1,500 @@
+/*
+* Priority Queue Service over Unix Domain Sockets
+* QueueServer<T> - single-threaded poll() loop owning a FibHeap, serves
+*   local clients over a Unix stream socket
+*   T must be trivially copyable and comparable with <
+* QueueClient<T> - client, collects requests into a batch and sends it in
+*   one write, several batches may be in flight (pipelining)
+* Wire format, both directions:
+*   uint32_t count, then count records of
+*   uint8_t op/status, uint64_t id, T key
+*   requests: OP_INSERT(key), OP_POP, OP_DECREASE(id, key)
+*   replies, one per request in order: status, id and key of the element
+* QueueServer Methods:
+*   1. QueueServer(const std::string &path) - bind and listen on path
+*   2. void run() - serve until stop() is called
+*   3. void stop() - make run() return, safe to call from other thread
+*   4. size_t size() - number of elements, only from run() thread
+*   All requests of a batch are applied before its replies are written
+*   back in one write; runs of inserts and pops within a batch go through
+*   FibHeap insert_batch/pop_batch.
+*   A connection isn't read while more than MAX_PENDING_REPLIES bytes of
+*   its replies wait to be sent, so a client that doesn't read its
+*   replies can't grow server memory. After a client shuts its side down,
+*   its complete batches are still applied and answered.
+* QueueClient Methods:
+*   1. QueueClient(const std::string &path) - connect to server
+*   2. void insert(const T &key), void pop(), void decrease_key(JobId id,
+*      const T &key) - add request to current batch
+*   3. void send() - send current batch
+*       pipelining limit: the server stops reading while more than
+*       MAX_PENDING_REPLIES (1 MB) of replies wait for a client, so a
+*       thread that only sends blocks forever once replies of its sent
+*       batches (4 bytes per batch, 9 + sizeof(T) per request) pass
+*       that; call receive() before, or receive from another thread
+*   4. std::vector<Reply> receive() - wait for replies of the oldest sent batch
+*   5. std::vector<Reply> execute() - send() then receive()
+* I/O errors are reported with std::runtime_error.
+*/
+#ifndef _ALG_QUEUE_SERVER
+#define _ALG_QUEUE_SERVER
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "FibHeap.h"
+
+namespace alg {
+    namespace queue_service {
+        using JobId = uint64_t;
+
+        enum Op : uint8_t {
+            OP_INSERT = 1,
+            OP_POP = 2,
+            OP_DECREASE = 3
+        };
+        enum Status : uint8_t {
+            OK = 0,
+            EMPTY = 1,     // pop from empty queue
+            NOT_FOUND = 2, // unknown id
+            INVALID = 3    // bad op or key increase
+        };
+
+        template <typename T>
+        struct Record {
+            static constexpr size_t SIZE = 1 + 8 + sizeof(T);
+
+            uint8_t code;
+            JobId id;
+            T key;
+
+            void encode(char *p) const {
+                p[0] = char(code);
+                std::memcpy(p + 1, &id, 8);
+                std::memcpy(p + 9, &key, sizeof(T));
+            }
+            static Record decode(const char *p) {
+                Record r;
+                r.code = uint8_t(p[0]);
+                std::memcpy(&r.id, p + 1, 8);
+                std::memcpy(&r.key, p + 9, sizeof(T));
+                return r;
+            }
+        };
+
+        static constexpr uint32_t MAX_BATCH = 1 << 16;
+        static constexpr size_t MAX_PENDING_REPLIES = 1 << 20;
+
+        inline void unix_address(const std::string &path, sockaddr_un &addr) {
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path))
+                throw std::runtime_error("Socket path is too long " + path);
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        }
+    }
+
+    template <typename T>
+    class QueueServer {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "QueueServer requires trivially copyable T");
+        using JobId = queue_service::JobId;
+        using Record = queue_service::Record<T>;
+
+        struct Entry {
+            T key;
+            JobId id;
+            bool operator < (const Entry &r) const {
+                return key < r.key || (!(r.key < key) && id < r.id);
+            }
+        };
+        using NodePtr = std::shared_ptr<FibHeapNode<Entry>>;
+
+        struct Connection {
+            int fd;
+            std::vector<char> in;
+            std::vector<char> out;
+            size_t out_pos = 0;
+            bool eof = false;
+        };
+
+        std::string path;
+        int listen_fd = -1;
+        int wake[2] = {-1, -1};
+        FibHeap<Entry> heap;
+        std::unordered_map<JobId, NodePtr> jobs;
+        JobId next_id = 1;
+        std::vector<std::unique_ptr<Connection>> conns;
+        std::vector<Entry> entries;     // scratch for insert_batch/pop_batch
+        std::vector<NodePtr> nodes;
+
+        static void set_nonblock(int fd) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+
+        Record apply(const Record &r) {
+            using namespace queue_service;
+            Record res{OK, r.id, r.key};
+            switch (r.code) {
+            case OP_INSERT:
+                res.id = next_id++;
+                jobs[res.id] = heap.insert(Entry{r.key, res.id});
+                break;
+            case OP_POP:
+                if (jobs.empty()) {
+                    res.code = EMPTY;
+                } else {
+                    Entry e = heap.pop();
+                    jobs.erase(e.id);
+                    res.id = e.id;
+                    res.key = e.key;
+                }
+                break;
+            case OP_DECREASE: {
+                auto it = jobs.find(r.id);
+                if (it == jobs.end()) {
+                    res.code = NOT_FOUND;
+                } else if (it->second->get_key().key < r.key) {
+                    res.code = INVALID;
+                } else {
+                    heap.decrease_key(it->second, Entry{r.key, r.id});
+                }
+                break;
+            }
+            default:
+                res.code = INVALID;
+                break;
+            }
+            return res;
+        }
+
+        // apply n requests with the same op code
+        void apply_run(const char *req, char *rep, uint32_t n) {
+            using namespace queue_service;
+            uint8_t op = uint8_t(req[0]);
+            if (op == OP_INSERT) {
+                entries.resize(n);
+                nodes.resize(n);
+                for (uint32_t i = 0; i < n; i++)
+                    entries[i] = Entry{Record::decode(req + i * Record::SIZE).key, next_id++};
+                heap.insert_batch(entries.data(), n, nodes.data());
+                for (uint32_t i = 0; i < n; i++) {
+                    jobs[entries[i].id] = std::move(nodes[i]);
+                    Record{OK, entries[i].id, entries[i].key}.encode(rep + i * Record::SIZE);
+                }
+            } else if (op == OP_POP) {
+                entries.resize(n);
+                size_t k = heap.pop_batch(entries.data(), std::min<size_t>(n, jobs.size()));
+                for (uint32_t i = 0; i < n; i++) {
+                    Record r = Record::decode(req + i * Record::SIZE);
+                    if (i < k) {
+                        jobs.erase(entries[i].id);
+                        r = Record{OK, entries[i].id, entries[i].key};
+                    } else {
+                        r.code = EMPTY;
+                    }
+                    r.encode(rep + i * Record::SIZE);
+                }
+            } else {
+                for (uint32_t i = 0; i < n; i++)
+                    apply(Record::decode(req + i * Record::SIZE)).encode(rep + i * Record::SIZE);
+            }
+        }
+
+        bool backed_up(const Connection &c) const {
+            return c.out.size() - c.out_pos > queue_service::MAX_PENDING_REPLIES;
+        }
+
+        // apply complete batches from c.in, return false on protocol error
+        bool process(Connection &c) {
+            size_t pos = 0;
+            while (c.in.size() - pos >= 4) {
+                uint32_t count;
+                std::memcpy(&count, c.in.data() + pos, 4);
+                if (count > queue_service::MAX_BATCH)
+                    return false;
+                size_t len = 4 + size_t(count) * Record::SIZE;
+                if (c.in.size() - pos < len)
+                    break;
+                size_t off = c.out.size();
+                c.out.resize(off + len);
+                std::memcpy(c.out.data() + off, &count, 4);
+                const char *req = c.in.data() + pos + 4;
+                char *rep = c.out.data() + off + 4;
+                for (uint32_t i = 0; i < count;) {
+                    uint32_t j = i + 1;
+                    while (j < count && req[j * Record::SIZE] == req[i * Record::SIZE])
+                        j++;
+                    apply_run(req + i * Record::SIZE, rep + i * Record::SIZE, j - i);
+                    i = j;
+                }
+                pos += len;
+            }
+            c.in.erase(c.in.begin(), c.in.begin() + pos);
+            return true;
+        }
+
+        // read and apply requests until the socket is drained or replies
+        // back up, return false if connection must be closed
+        bool on_read(Connection &c) {
+            char buf[1 << 16];
+            while (!c.eof && !backed_up(c)) {
+                ssize_t n = ::read(c.fd, buf, sizeof(buf));
+                if (n > 0) {
+                    c.in.insert(c.in.end(), buf, buf + n);
+                    if (!process(c) || !on_write(c))
+                        return false;
+                    continue;
+                }
+                if (n == 0) {
+                    // a torn batch at the end is dropped
+                    c.eof = true;
+                    break;
+                }
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                return false;
+            }
+            return true;
+        }
+        bool on_write(Connection &c) {
+            while (c.out_pos < c.out.size()) {
+                ssize_t n = ::send(c.fd, c.out.data() + c.out_pos,
+                                   c.out.size() - c.out_pos, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return true;
+                    return false;
+                }
+                c.out_pos += size_t(n);
+            }
+            c.out.clear();
+            c.out_pos = 0;
+            return true;
+        }
+
+        void accept_all() {
+            for (;;) {
+                int fd = ::accept(listen_fd, nullptr, nullptr);
+                if (fd < 0)
+                    return;
+                set_nonblock(fd);
+                conns.emplace_back(new Connection{fd, {}, {}, 0});
+            }
+        }
+
+    public:
+        explicit QueueServer(const std::string &path) : path(path) {
+            sockaddr_un addr;
+            queue_service::unix_address(path, addr);
+            listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listen_fd < 0)
+                throw std::runtime_error("QueueServer can't create socket");
+            ::unlink(path.c_str());
+            if (::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+                || ::listen(listen_fd, 128) != 0 || ::pipe(wake) != 0) {
+                ::close(listen_fd);
+                throw std::runtime_error("QueueServer can't listen on " + path);
+            }
+            set_nonblock(listen_fd);
+            set_nonblock(wake[0]);
+        }
+        QueueServer(const QueueServer &) = delete;
+        QueueServer &operator = (const QueueServer &) = delete;
+        ~QueueServer() {
+            for (auto &c : conns)
+                ::close(c->fd);
+            ::close(listen_fd);
+            ::close(wake[0]);
+            ::close(wake[1]);
+            ::unlink(path.c_str());
+        }
+
+        size_t size() const noexcept {
+            return jobs.size();
+        }
+
+        void stop() {
+            char b = 1;
+            while (::write(wake[1], &b, 1) < 0 && errno == EINTR) {
+            }
+        }
+
+        void run() {
+            std::vector<pollfd> fds;
+            for (;;) {
+                fds.clear();
+                fds.push_back(pollfd{wake[0], POLLIN, 0});
+                fds.push_back(pollfd{listen_fd, POLLIN, 0});
+                for (auto &c : conns) {
+                    short ev = 0;
+                    if (!c->eof && !backed_up(*c))
+                        ev |= POLLIN;
+                    if (c->out_pos < c->out.size())
+                        ev |= POLLOUT;
+                    fds.push_back(pollfd{c->fd, ev, 0});
+                }
+                if (::poll(fds.data(), nfds_t(fds.size()), -1) < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error("QueueServer poll failed");
+                }
+                if (fds[0].revents) {
+                    char b;
+                    while (::read(wake[0], &b, 1) > 0) {
+                    }
+                    return;
+                }
+                size_t n = conns.size();
+                size_t live = 0;
+                for (size_t i = 0; i < n; i++) {
+                    Connection &c = *conns[i];
+                    short ev = fds[i + 2].revents;
+                    bool ok = true;
+                    if (ev & (POLLIN | POLLHUP | POLLERR))
+                        ok = on_read(c);
+                    if (ok && (ev & (POLLOUT | POLLHUP | POLLERR)))
+                        ok = on_write(c);
+                    if (ok && c.eof && c.out_pos == c.out.size())
+                        ok = false;
+                    if (ok) {
+                        conns[live++] = std::move(conns[i]);
+                    } else {
+                        ::close(c.fd);
+                    }
+                }
+                conns.resize(live);
+                if (fds[1].revents)
+                    accept_all();
+            }
+        }
+    };
+
+    template <typename T>
+    class QueueClient {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "QueueClient requires trivially copyable T");
+        using Record = queue_service::Record<T>;
+
+    public:
+        using JobId = queue_service::JobId;
+        struct Reply {
+            queue_service::Status status;
+            JobId id;
+            T key;
+        };
+
+    private:
+        int fd = -1;
+        std::vector<char> batch;
+        uint32_t count = 0;
+
+        void write_all(const char *data, size_t n) {
+            while (n > 0) {
+                ssize_t w = ::send(fd, data, n, MSG_NOSIGNAL);
+                if (w < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error("QueueClient write failed");
+                }
+                data += w;
+                n -= size_t(w);
+            }
+        }
+        void read_all(char *data, size_t n) {
+            while (n > 0) {
+                ssize_t r = ::read(fd, data, n);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    throw std::runtime_error("QueueClient read failed");
+                data += r;
+                n -= size_t(r);
+            }
+        }
+
+        void add(queue_service::Op op, JobId id, const T &key) {
+            if (count == queue_service::MAX_BATCH)
+                throw std::length_error("QueueClient batch is too large");
+            if (batch.empty())
+                batch.resize(4);
+            size_t off = batch.size();
+            batch.resize(off + Record::SIZE);
+            Record{uint8_t(op), id, key}.encode(batch.data() + off);
+            count++;
+        }
+
+    public:
+        explicit QueueClient(const std::string &path) {
+            sockaddr_un addr;
+            queue_service::unix_address(path, addr);
+            fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                throw std::runtime_error("QueueClient can't create socket");
+            if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                throw std::runtime_error("QueueClient can't connect to " + path);
+            }
+        }
+        QueueClient(const QueueClient &) = delete;
+        QueueClient &operator = (const QueueClient &) = delete;
+        ~QueueClient() {
+            ::close(fd);
+        }
+
+        void insert(const T &key) {
+            add(queue_service::OP_INSERT, 0, key);
+        }
+        void pop() {
+            add(queue_service::OP_POP, 0, T());
+        }
+        void decrease_key(JobId id, const T &key) {
+            add(queue_service::OP_DECREASE, id, key);
+        }
+
+        void send() {
+            if (count == 0)
+                return;
+            std::memcpy(batch.data(), &count, 4);
+            write_all(batch.data(), batch.size());
+            batch.clear();
+            count = 0;
+        }
+
+        std::vector<Reply> receive() {
+            uint32_t n;
+            read_all(reinterpret_cast<char *>(&n), 4);
+            std::vector<char> buf(size_t(n) * Record::SIZE);
+            read_all(buf.data(), buf.size());
+            std::vector<Reply> res(n);
+            for (uint32_t i = 0; i < n; i++) {
+                Record r = Record::decode(buf.data() + i * Record::SIZE);
+                res[i] = Reply{queue_service::Status(r.code), r.id, r.key};
+            }
+            return res;
+        }
+
+        std::vector<Reply> execute() {
+            send();
+            return receive();
+        }
+    };
+}
+
+#endif // _ALG_QUEUE_SERVER
@@ -0,0 +1,219 @@
+/*
+* Sliding Window Running Median and Quantile
+* RunningQuantile<T, Compare, Index> - q-quantile of the last W values of
+*   a stream; values live in a ring buffer, their slots are kept in one
+*   indexed heap array: position 0 holds the quantile, a max-heap of
+*   smaller values grows to negative positions and a min-heap of larger
+*   values grows to positive ones, so the value leaving the window is
+*   found through its slot and replaced in place by the new one
+*   memory is W values and 2W indexes, Index = uint16_t halves index
+*   storage for windows up to 65535
+* RunningMedian<T, Compare, Index> - same with q = 0.5, lower median for
+*   even counts
+* Methods:
+*   1. RunningQuantile(size_t window, double q = 0.5)
+*   2. size_t size(), size_t window(), bool empty(), void clear()
+*   3. const T &get() - value of rank floor(q * (size() - 1))
+*       complexity: O(1)
+*   4. void push(const T &d) - add d, drop oldest value if window is full
+*       complexity: O(lg(W))
+*   5. void push(const T *d, size_t n, T *out = nullptr) - push n values,
+*       out[i] = get() after d[i]; without out only the final state is
+*       needed, so steps of at least W/2 values rebuild the heaps instead
+*       complexity: O(n lg(W)), O(W) for a rebuilt step
+*/
+#ifndef _ALG_RUNNING_MEDIAN
+#define _ALG_RUNNING_MEDIAN
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T, typename Compare = std::less<T>, typename Index = uint32_t>
+    class RunningQuantile {
+        std::unique_ptr<T[]> data;      // ring buffer of window values
+        std::unique_ptr<Index[]> idx;   // [0, W) heap position of slot + off, [W, 2W) heap
+        double q;
+        Index w;
+        Index ct = 0;
+        Index next = 0;                 // slot of the next value
+        Index low = 0;                  // values below position 0
+        Index high = 0;                 // values above position 0
+        Index off;                      // rank of the quantile in a full window
+        Compare comp;
+
+        Index rank(size_t n) const {
+            return Index(q * double(n - 1));
+        }
+        Index *heap() {
+            return idx.get() + w + off;
+        }
+        bool less_at(long a, long b) {
+            Index *h = heap();
+            return comp(data[h[a]], data[h[b]]);
+        }
+        void exchange(long a, long b) {
+            Index *h = heap();
+            std::swap(h[a], h[b]);
+            idx[h[a]] = Index(a + off);
+            idx[h[b]] = Index(b + off);
+        }
+
+        // parent of c is c / 2, children of p are 2p and 2p + sign(p)
+        long sift_up(long c) {
+            while (c != 0) {
+                long p = c / 2;
+                if (c > 0 ? !less_at(c, p) : !less_at(p, c))
+                    break;
+                exchange(c, p);
+                c = p;
+            }
+            return c;
+        }
+        void sift_down_high(long p) {
+            for (;;) {
+                long c = p == 0 ? 1 : 2 * p;
+                if (c > long(high))
+                    break;
+                if (p != 0 && c + 1 <= long(high) && less_at(c + 1, c))
+                    c++;
+                if (!less_at(c, p))
+                    break;
+                exchange(c, p);
+                p = c;
+            }
+        }
+        void sift_down_low(long p) {
+            for (;;) {
+                long c = p == 0 ? -1 : 2 * p;
+                if (-c > long(low))
+                    break;
+                if (p != 0 && 1 - c <= long(low) && less_at(c, c - 1))
+                    c--;
+                if (!less_at(p, c))
+                    break;
+                exchange(c, p);
+                p = c;
+            }
+        }
+        // value at position p changed
+        void fix(long p) {
+            long r = sift_up(p);
+            if (r == 0) {
+                // value reached the middle, at most one side is out of order
+                sift_down_low(0);
+                sift_down_high(0);
+            } else if (r == p) {
+                if (p > 0)
+                    sift_down_high(p);
+                else
+                    sift_down_low(p);
+            }
+        }
+
+        // heaps from scratch over slots [0, ct)
+        void rebuild() {
+            low = rank(ct);
+            high = Index(ct - 1 - low);
+            Index *h = heap();
+            Index *first = h - low;
+            for (Index s = 0; s < ct; s++)
+                first[s] = s;
+            auto less = [this](Index a, Index b) { return comp(data[a], data[b]); };
+            auto greater = [this](Index a, Index b) { return comp(data[b], data[a]); };
+            std::nth_element(first, h, h + high + 1, less);
+            // positions 1, 2, .. are a 0-based heap from h + 1, -1, -2, .. from h - 1 downwards
+            std::make_heap(h + 1, h + high + 1, greater);
+            std::make_heap(std::reverse_iterator<Index *>(h), std::reverse_iterator<Index *>(first), less);
+            for (long p = -long(low); p <= long(high); p++)
+                idx[h[p]] = Index(p + off);
+        }
+
+    public:
+        explicit RunningQuantile(size_t window, double q = 0.5, Compare c = Compare())
+            : q(q), w(Index(window)), comp(c) {
+            if (window == 0 || window != size_t(w))
+                throw std::invalid_argument("RunningQuantile window doesn't fit Index");
+            if (!(q >= 0 && q <= 1))
+                throw std::invalid_argument("RunningQuantile q must be in [0, 1]");
+            off = rank(w);
+            data.reset(new T[window]);
+            idx.reset(new Index[2 * window]);
+        }
+
+        size_t size() const noexcept {
+            return ct;
+        }
+        size_t window() const noexcept {
+            return w;
+        }
+        bool empty() const noexcept {
+            return ct == 0;
+        }
+        void clear() noexcept {
+            ct = next = low = high = 0;
+        }
+
+        const T &get() const {
+            if (ct == 0)
+                throw std::out_of_range("get from empty RunningQuantile");
+            return data[idx[w + off]];
+        }
+
+        void push(const T &d) {
+            Index s = next;
+            next = Index(next + 1 == w ? 0 : next + 1);
+            data[s] = d;
+            if (ct == w) {
+                fix(long(idx[s]) - long(off));
+                return;
+            }
+            // filling: rank grows by at most one, new leaf goes to the side that grows
+            long p = 0;
+            if (ct > 0)
+                p = rank(size_t(ct) + 1) > low ? -long(++low) : long(++high);
+            heap()[p] = s;
+            idx[s] = Index(p + off);
+            ct++;
+            fix(p);
+        }
+
+        void push(const T *d, size_t n, T *out = nullptr) {
+            if (out != nullptr || 2 * n < w) {
+                for (size_t i = 0; i < n; i++) {
+                    push(d[i]);
+                    if (out != nullptr)
+                        out[i] = get();
+                }
+                return;
+            }
+            // only the last W values can stay in the window
+            for (size_t i = n > w ? n - w : 0; i < n; i++) {
+                data[next] = d[i];
+                next = Index(next + 1 == w ? 0 : next + 1);
+            }
+            ct = Index(std::min<size_t>(size_t(ct) + n, w));
+            rebuild();
+        }
+    };
+
+    template <typename T, typename Compare = std::less<T>, typename Index = uint32_t>
+    class RunningMedian : public RunningQuantile<T, Compare, Index> {
+    public:
+        explicit RunningMedian(size_t window, Compare c = Compare())
+            : RunningQuantile<T, Compare, Index>(window, 0.5, c) {
+        }
+
+        const T &median() const {
+            return this->get();
+        }
+    };
+}
+
+#endif // _ALG_RUNNING_MEDIAN
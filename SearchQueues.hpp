@@ -0,0 +1,255 @@
+/*
+* Candidate and Result Queues for Nearest Neighbor Graph Search
+* FixedHeap<T, CAP, Compare> - array heap with inline storage of CAP
+*   elements, top is the smallest by Compare; child selection in sift
+*   down is branchless
+* Methods:
+*   1. size_t size(), bool empty(), bool full(), void clear()
+*   2. const T &top()
+*       complexity: O(1)
+*   3. void push(const T &d) - throws std::length_error when full
+*       complexity: O(lg(CAP))
+*      bool push_bounded(const T &d) - when full, d replaces the largest
+*       element if it is smaller, return false if d was dropped
+*       complexity: O(lg(CAP)), O(CAP) when full
+*   4. T pop(), void replace_top(const T &d)
+*       complexity: O(lg(CAP))
+*   5. const T *begin(), const T *end() - elements in heap order
+* VisitedSet - visited flags of graph vertices, reset() is O(1): every
+*   vertex keeps the epoch it was visited in
+* Methods:
+*   1. VisitedSet(size_t n), void resize(size_t n)
+*   2. void reset() - forget all visits
+*   3. bool visit(size_t v) - mark v, return false if already visited
+* SearchQueues<Dist, Id, CAP> - HNSW-style search state: min queue of
+*   candidates to expand and max queue of ef best results
+* Methods:
+*   1. void reset(size_t ef) - start new search, ef <= CAP
+*   2. bool offer(Dist d, Id id) - add vertex at distance d if it can
+*       improve results, return false otherwise
+*   3. bool next(Item &out) - pop closest candidate, false when search is
+*       over (no candidates or closest one is farther than all results)
+*   4. Dist worst() - largest result distance
+*   5. void results(std::vector<Item> &out) - results, closest first
+* search_layer(q, visited, entry, ef, neighbors, distance) - greedy best
+*   first search of one graph layer with the above; neighbors(id) returns
+*   an iterable of ids, distance(id) returns Dist to query
+*/
+#ifndef _ALG_SEARCH_QUEUES
+#define _ALG_SEARCH_QUEUES
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T, size_t CAP, typename Compare = std::less<T>>
+    class FixedHeap {
+        std::array<T, CAP> a;
+        size_t n = 0;
+        Compare comp;
+
+        void sift_down(size_t i, const T &x) {
+            for (;;) {
+                size_t c = 2 * i + 1;
+                if (c >= n)
+                    break;
+                c += size_t(c + 1 < n) & size_t(comp(a[c + 1 < n ? c + 1 : c], a[c]));
+                if (!comp(a[c], x))
+                    break;
+                a[i] = a[c];
+                i = c;
+            }
+            a[i] = x;
+        }
+
+        void sift_up(size_t i, const T &d) {
+            while (i > 0) {
+                size_t p = (i - 1) / 2;
+                if (!comp(d, a[p]))
+                    break;
+                a[i] = a[p];
+                i = p;
+            }
+            a[i] = d;
+        }
+
+    public:
+        explicit FixedHeap(Compare c = Compare()) : comp(c) {
+        }
+
+        size_t size() const noexcept {
+            return n;
+        }
+        bool empty() const noexcept {
+            return n == 0;
+        }
+        bool full() const noexcept {
+            return n == CAP;
+        }
+        void clear() noexcept {
+            n = 0;
+        }
+
+        const T &top() const {
+            if (n == 0)
+                throw std::out_of_range("top of empty FixedHeap");
+            return a[0];
+        }
+
+        void push(const T &d) {
+            if (n == CAP)
+                throw std::length_error("FixedHeap is full");
+            sift_up(n++, d);
+        }
+
+        // when full, d replaces the largest element (a leaf) if it is smaller
+        bool push_bounded(const T &d) {
+            if (n < CAP) {
+                sift_up(n++, d);
+                return true;
+            }
+            T *worst = std::max_element(a.data() + n / 2, a.data() + n, comp);
+            if (!comp(d, *worst))
+                return false;
+            sift_up(size_t(worst - a.data()), d);
+            return true;
+        }
+
+        T pop() {
+            if (n == 0)
+                throw std::out_of_range("Pop from empty FixedHeap");
+            T res = a[0];
+            n--;
+            if (n > 0)
+                sift_down(0, a[n]);
+            return res;
+        }
+
+        void replace_top(const T &d) {
+            if (n == 0)
+                throw std::out_of_range("replace_top of empty FixedHeap");
+            sift_down(0, d);
+        }
+
+        const T *begin() const noexcept {
+            return a.data();
+        }
+        const T *end() const noexcept {
+            return a.data() + n;
+        }
+    };
+
+    class VisitedSet {
+        std::vector<uint16_t> tags;
+        uint16_t epoch = 1;
+
+    public:
+        explicit VisitedSet(size_t n = 0) : tags(n, 0) {
+        }
+        void resize(size_t n) {
+            tags.assign(n, 0);
+            epoch = 1;
+        }
+        size_t size() const noexcept {
+            return tags.size();
+        }
+
+        void reset() {
+            if (++epoch == 0) {
+                // tags of old epochs could collide after wrap around
+                std::fill(tags.begin(), tags.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        bool visit(size_t v) {
+            if (tags[v] == epoch)
+                return false;
+            tags[v] = epoch;
+            return true;
+        }
+    };
+
+    template <typename Dist = float, typename Id = uint32_t, size_t CAP = 512>
+    class SearchQueues {
+    public:
+        struct Item {
+            Dist dist;
+            Id id;
+            bool operator < (const Item &r) const {
+                return dist < r.dist || (!(r.dist < dist) && id < r.id);
+            }
+            bool operator > (const Item &r) const {
+                return r < *this;
+            }
+        };
+
+    private:
+        FixedHeap<Item, CAP> candidates;                     // closest on top
+        FixedHeap<Item, CAP, std::greater<Item>> best;       // farthest on top
+        size_t ef = 1;
+
+    public:
+        void reset(size_t ef) {
+            if (ef == 0 || ef > CAP)
+                throw std::invalid_argument("SearchQueues ef must be in [1, CAP]");
+            this->ef = ef;
+            candidates.clear();
+            best.clear();
+        }
+
+        Dist worst() const {
+            return best.top().dist;
+        }
+
+        bool offer(Dist d, Id id) {
+            Item it{d, id};
+            if (best.size() >= ef) {
+                if (!(it < best.top()))
+                    return false;
+                best.replace_top(it);
+            } else {
+                best.push(it);
+            }
+            candidates.push_bounded(it);
+            return true;
+        }
+
+        bool next(Item &out) {
+            if (candidates.empty())
+                return false;
+            if (best.size() >= ef && best.top() < candidates.top())
+                return false;
+            out = candidates.pop();
+            return true;
+        }
+
+        void results(std::vector<Item> &out) const {
+            out.assign(best.begin(), best.end());
+            std::sort(out.begin(), out.end());
+        }
+    };
+
+    template <typename Dist, typename Id, size_t CAP, typename Neighbors, typename Distance>
+    void search_layer(SearchQueues<Dist, Id, CAP> &q, VisitedSet &visited, Id entry,
+                      size_t ef, Neighbors &&neighbors, Distance &&distance) {
+        q.reset(ef);
+        visited.reset();
+        visited.visit(size_t(entry));
+        q.offer(distance(entry), entry);
+        typename SearchQueues<Dist, Id, CAP>::Item c;
+        while (q.next(c)) {
+            for (Id v : neighbors(c.id)) {
+                if (visited.visit(size_t(v)))
+                    q.offer(distance(v), v);
+            }
+        }
+    }
+}
+
+#endif // _ALG_SEARCH_QUEUES
@@ -0,0 +1,305 @@
+/*
+* Shared-memory Multi-process Priority Queue
+* SharedHeap<T, Compare> - array binary heap living in a POSIX shared
+*   memory segment, so several processes can push/pop directly
+*   T must be trivially copyable, min element (by Compare) is popped first
+*   segment holds header, robust process-shared mutex and element array,
+*   elements are addressed by index, so every process may map it anywhere
+*   if a process dies holding the lock, next locker finishes its
+*   interrupted operation from the journal in header and rebuilds heap
+*   opening is serialized by flock on the segment, so an opener waits
+*   for the creator to finish init; lock of a dead creator is released
+*   by the kernel and the segment it left uninitialized is initialized
+*   by the next opener
+* Methods:
+*   1. SharedHeap(const std::string &name, size_t capacity)
+*       open segment name, create it with capacity elements if missing
+*       or not initialized
+*   2. static void remove(const std::string &name) - unlink segment
+*   3. size_t size(), size_t capacity()
+*   4. void push(const T &d) - throws std::length_error when full
+*       complexity: O(lg(N))
+*   5. bool try_pop(T &out) - pop min element, false if empty
+*       complexity: O(lg(N))
+*   6. T pop() - throws std::out_of_range if empty
+*   7. void push_batch(const T *d, size_t n),
+*      size_t pop_batch(T *out, size_t n) - several elements under
+*       one lock acquisition
+* Element popped by a process that died before return is lost.
+*/
+#ifndef _ALG_SHARED_HEAP
+#define _ALG_SHARED_HEAP
+
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+namespace alg {
+    template <typename T, typename Compare = std::less<T>>
+    class SharedHeap {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "SharedHeap requires trivially copyable T");
+        static constexpr uint64_t MAGIC = 0x5041454853474c41ull; // "ALGSHEAP"
+        static constexpr uint32_t VERSION = 1;
+        enum : uint32_t {
+            OP_NONE = 0,
+            OP_PUSH = 1,
+            OP_POP = 2
+        };
+
+        struct Header {
+            std::atomic<uint64_t> magic;
+            uint32_t version;
+            uint32_t key_size;
+            uint64_t capacity;
+            uint64_t size;
+            pthread_mutex_t mutex;
+            // journal of operation in progress: element pending is moved
+            // to its place through hole, heap size becomes op_size
+            uint32_t op;
+            uint64_t hole;
+            uint64_t op_size;
+            T pending;
+        };
+        static constexpr size_t HEADER_SIZE = (sizeof(Header) + 63) / 64 * 64;
+
+        int fd = -1;
+        void *base = nullptr;
+        size_t mapped = 0;
+        Header *h = nullptr;
+        T *a = nullptr;
+        Compare comp;
+
+        static void barrier() {
+            // a process may die between any two stores
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+
+        void map(size_t bytes) {
+            void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED)
+                throw std::runtime_error("SharedHeap mmap failed");
+            base = p;
+            mapped = bytes;
+            h = static_cast<Header *>(base);
+            a = reinterpret_cast<T *>(static_cast<char *>(base) + HEADER_SIZE);
+        }
+
+        void init(size_t capacity) {
+            h->version = VERSION;
+            h->key_size = sizeof(T);
+            h->capacity = capacity;
+            h->size = 0;
+            h->op = OP_NONE;
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            int rc = pthread_mutex_init(&h->mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+            if (rc != 0)
+                throw std::runtime_error("SharedHeap can't init mutex");
+            h->magic.store(MAGIC, std::memory_order_release);
+        }
+
+        void recover() {
+            if (h->op != OP_NONE) {
+                h->size = h->op_size;
+                a[h->hole] = h->pending;
+                barrier();
+                h->op = OP_NONE;
+            }
+            // interrupted sift may leave heap order broken
+            std::make_heap(a, a + h->size, [this](const T &x, const T &y) { return comp(y, x); });
+        }
+
+        void lock() {
+            int rc = pthread_mutex_lock(&h->mutex);
+            if (rc == EOWNERDEAD) {
+                recover();
+                pthread_mutex_consistent(&h->mutex);
+            } else if (rc != 0) {
+                throw std::runtime_error("SharedHeap lock failed");
+            }
+        }
+        void unlock() {
+            pthread_mutex_unlock(&h->mutex);
+        }
+        struct Guard {
+            SharedHeap *s;
+            explicit Guard(SharedHeap *heap) : s(heap) {
+                s->lock();
+            }
+            ~Guard() {
+                s->unlock();
+            }
+        };
+
+        void finish_op() {
+            a[h->hole] = h->pending;
+            barrier();
+            h->op = OP_NONE;
+        }
+
+        void push_locked(const T &d) {
+            if (h->size >= h->capacity)
+                throw std::length_error("SharedHeap is full");
+            h->pending = d;
+            h->hole = h->size;
+            h->op_size = h->size + 1;
+            barrier();
+            h->op = OP_PUSH;
+            barrier();
+            h->size = h->op_size;
+            uint64_t i = h->hole;
+            while (i > 0) {
+                uint64_t p = (i - 1) / 2;
+                if (!comp(h->pending, a[p]))
+                    break;
+                a[i] = a[p];
+                barrier();
+                h->hole = i = p;
+            }
+            finish_op();
+        }
+
+        bool pop_locked(T &out) {
+            if (h->size == 0)
+                return false;
+            out = a[0];
+            h->pending = a[h->size - 1];
+            h->hole = 0;
+            h->op_size = h->size - 1;
+            barrier();
+            h->op = OP_POP;
+            barrier();
+            uint64_t n = h->size = h->op_size;
+            if (n == 0) {
+                h->op = OP_NONE;
+                return true;
+            }
+            uint64_t i = 0;
+            for (;;) {
+                uint64_t c = 2 * i + 1;
+                if (c >= n)
+                    break;
+                if (c + 1 < n && comp(a[c + 1], a[c]))
+                    c++;
+                if (!comp(a[c], h->pending))
+                    break;
+                a[i] = a[c];
+                barrier();
+                h->hole = i = c;
+            }
+            finish_op();
+            return true;
+        }
+
+    public:
+        SharedHeap(const std::string &name, size_t capacity, Compare c = Compare())
+            : comp(c) {
+            fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+            if (fd < 0)
+                throw std::runtime_error("SharedHeap can't open " + name);
+            int rc;
+            while ((rc = flock(fd, LOCK_EX)) != 0 && errno == EINTR)
+                ;
+            if (rc != 0) {
+                ::close(fd);
+                throw std::runtime_error("SharedHeap can't lock " + name);
+            }
+            try {
+                struct stat st;
+                if (fstat(fd, &st) != 0)
+                    throw std::runtime_error("SharedHeap can't stat " + name);
+                if (size_t(st.st_size) >= HEADER_SIZE) {
+                    map(size_t(st.st_size));
+                    if (h->magic.load(std::memory_order_acquire) == MAGIC) {
+                        if (h->version != VERSION || h->key_size != sizeof(T)
+                            || HEADER_SIZE + h->capacity * sizeof(T) > mapped)
+                            throw std::runtime_error("SharedHeap segment has wrong format " + name);
+                        flock(fd, LOCK_UN);
+                        return;
+                    }
+                    munmap(base, mapped);
+                    base = nullptr;
+                }
+                // new segment, or its creator died before init
+                size_t bytes = HEADER_SIZE + capacity * sizeof(T);
+                if (ftruncate(fd, off_t(bytes)) != 0)
+                    throw std::runtime_error("SharedHeap can't size " + name);
+                map(bytes);
+                init(capacity);
+            } catch (...) {
+                if (base)
+                    munmap(base, mapped);
+                base = nullptr;
+                ::close(fd);
+                fd = -1;
+                throw;
+            }
+            flock(fd, LOCK_UN);
+        }
+        SharedHeap(const SharedHeap &) = delete;
+        SharedHeap &operator = (const SharedHeap &) = delete;
+        ~SharedHeap() {
+            if (base)
+                munmap(base, mapped);
+            if (fd >= 0)
+                ::close(fd);
+        }
+
+        static void remove(const std::string &name) {
+            shm_unlink(name.c_str());
+        }
+
+        size_t size() {
+            Guard g(this);
+            return size_t(h->size);
+        }
+        size_t capacity() const noexcept {
+            return size_t(h->capacity);
+        }
+
+        void push(const T &d) {
+            Guard g(this);
+            push_locked(d);
+        }
+        void push_batch(const T *d, size_t n) {
+            Guard g(this);
+            for (size_t i = 0; i < n; i++)
+                push_locked(d[i]);
+        }
+
+        bool try_pop(T &out) {
+            Guard g(this);
+            return pop_locked(out);
+        }
+        T pop() {
+            T res;
+            if (!try_pop(res))
+                throw std::out_of_range("Pop from empty SharedHeap");
+            return res;
+        }
+        size_t pop_batch(T *out, size_t n) {
+            Guard g(this);
+            size_t i = 0;
+            while (i < n && pop_locked(out[i]))
+                i++;
+            return i;
+        }
+    };
+}
+
+#endif // _ALG_SHARED_HEAP
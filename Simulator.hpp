@@ -0,0 +1,357 @@
+/*
+* Discrete Event Simulation Kernel
+* Simulator<Queue> - event loop on top of library heaps
+*   Queue is any heap with size/get_min/insert/pop:
+*   CalendarQueue (default), FibHeap, Bheap
+*   Events with equal timestamp are processed as one batch. When threads > 1
+*   and every event of the batch names an entity, groups of events of
+*   different entities run in parallel, events of one entity run in order.
+* Simulator<Queue>::Handle - returned by schedule, required only for cancel
+* Methods:
+*   1. size_t size() - number of pending events
+*   2. double now() - current simulation time
+*   3. Handle schedule(double t, Action a, uint64_t entity = NO_ENTITY)
+*       schedule a(sim) at time t, t < now() is treated as now()
+*       complexity: Queue insert
+*   4. bool cancel(const Handle &h) - cancel pending event, also one of
+*       the current batch that hasn't started yet
+*       return false if event already ran, is running or was cancelled
+*       complexity: O(1), cancelled events are dropped lazily on pop
+*   5. size_t step() - process next batch, return number of events run
+*       if actions throw, the rest of the batch still runs, then the
+*       first exception is rethrown
+*   6. size_t run(double until) - process batches with time <= until
+*       return number of events run
+*   7. void set_threads(unsigned n) - worker threads for parallel batches
+* schedule/cancel may be called from actions, also from parallel ones.
+* Events scheduled by a parallel batch get the same order as if the batch
+* ran sequentially.
+*/
+#ifndef _ALG_SIMULATOR
+#define _ALG_SIMULATOR
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include "CalendarQueue.hpp"
+
+namespace alg {
+    template <template <typename...> class Queue = CalendarQueue>
+    class Simulator {
+    public:
+        using Action = std::function<void(Simulator &)>;
+        static constexpr uint64_t NO_ENTITY = UINT64_MAX;
+        struct Handle {
+            uint32_t slot = UINT32_MAX;
+            uint32_t gen = 0;
+        };
+
+    private:
+        struct Event {
+            double time;
+            uint64_t seq;
+            uint32_t slot;
+            uint32_t gen;
+            bool operator < (const Event &r) const {
+                return time < r.time || (time == r.time && seq < r.seq);
+            }
+            // bucket time for CalendarQueue
+            explicit operator double() const {
+                return time;
+            }
+        };
+        struct Slot {
+            Action action;
+            uint64_t entity;
+            uint32_t gen = 0;
+            bool pending = false;
+        };
+        struct Running {
+            uint64_t seq;
+            uint64_t entity;
+            uint32_t slot;
+            uint32_t gen;
+        };
+        struct Staged {
+            uint64_t src_seq;
+            uint64_t order;
+            double time;
+            uint32_t slot;
+            uint32_t gen;
+        };
+
+        Queue<Event> queue;
+        std::vector<Slot> slots;
+        std::vector<uint32_t> free_slots;
+        std::vector<Running> batch;
+        std::vector<size_t> group_start;
+        std::vector<Staged> staged;
+        double _now = 0;
+        uint64_t next_seq = 0;
+        size_t _size = 0;
+        bool parallel_phase = false;
+        std::mutex lock;
+
+        // seq of event running on this thread, orders staged events
+        static inline thread_local uint64_t cur_seq = 0;
+        static inline thread_local uint64_t cur_order = 0;
+
+        // worker pool for parallel batches
+        std::vector<std::thread> workers;
+        std::mutex pool_lock;
+        std::condition_variable pool_cv, done_cv;
+        uint64_t job_id = 0;
+        unsigned busy = 0;
+        bool stopping = false;
+        std::atomic<size_t> next_group{0};
+        std::atomic<size_t> ran{0};
+        std::exception_ptr error;
+
+        uint32_t alloc_slot() {
+            if (!free_slots.empty()) {
+                uint32_t x = free_slots.back();
+                free_slots.pop_back();
+                return x;
+            }
+            slots.emplace_back();
+            return uint32_t(slots.size() - 1);
+        }
+        void free_slot(uint32_t x) {
+            slots[x].action = nullptr;
+            slots[x].pending = false;
+            slots[x].gen++;
+            free_slots.push_back(x);
+        }
+
+        // slot stays pending until its event starts, so it can be
+        // cancelled from an earlier event of the batch
+        bool run_event(const Running &e) {
+            Action action;
+            {
+                std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+                if (parallel_phase)
+                    guard.lock();
+                Slot &s = slots[e.slot];
+                if (s.gen != e.gen || !s.pending)
+                    return false;
+                action = std::move(s.action);
+                free_slot(e.slot);
+                _size--;
+            }
+            cur_seq = e.seq;
+            cur_order = 0;
+            try {
+                action(*this);
+            } catch (...) {
+                std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+                if (parallel_phase)
+                    guard.lock();
+                if (!error)
+                    error = std::current_exception();
+            }
+            return true;
+        }
+
+        void run_groups() {
+            size_t n = 0;
+            for (;;) {
+                size_t g = next_group.fetch_add(1);
+                if (g + 1 >= group_start.size())
+                    break;
+                for (size_t i = group_start[g]; i < group_start[g + 1]; i++)
+                    n += run_event(batch[i]);
+            }
+            ran += n;
+        }
+
+        void worker_loop() {
+            uint64_t seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> guard(pool_lock);
+                    pool_cv.wait(guard, [&] { return stopping || job_id != seen; });
+                    if (stopping)
+                        return;
+                    seen = job_id;
+                }
+                run_groups();
+                std::lock_guard<std::mutex> guard(pool_lock);
+                if (--busy == 0)
+                    done_cv.notify_one();
+            }
+        }
+
+        void stop_workers() {
+            {
+                std::lock_guard<std::mutex> guard(pool_lock);
+                stopping = true;
+            }
+            pool_cv.notify_all();
+            for (auto &w : workers)
+                w.join();
+            workers.clear();
+            stopping = false;
+        }
+
+        bool can_run_parallel() {
+            if (workers.empty() || batch.size() < 2)
+                return false;
+            for (auto &e : batch) {
+                if (e.entity == NO_ENTITY)
+                    return false;
+            }
+            // group by entity, keep seq order inside a group
+            std::stable_sort(batch.begin(), batch.end(),
+                             [](const Running &a, const Running &b) {
+                                 return a.entity < b.entity;
+                             });
+            group_start.clear();
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (i == 0 || batch[i].entity != batch[i - 1].entity)
+                    group_start.push_back(i);
+            }
+            group_start.push_back(batch.size());
+            return group_start.size() > 2;
+        }
+
+        void run_parallel() {
+            parallel_phase = true;
+            next_group = 0;
+            {
+                std::lock_guard<std::mutex> guard(pool_lock);
+                busy = unsigned(workers.size());
+                job_id++;
+            }
+            pool_cv.notify_all();
+            run_groups();
+            {
+                std::unique_lock<std::mutex> guard(pool_lock);
+                done_cv.wait(guard, [&] { return busy == 0; });
+            }
+            parallel_phase = false;
+            std::sort(staged.begin(), staged.end(),
+                      [](const Staged &a, const Staged &b) {
+                          return a.src_seq < b.src_seq
+                              || (a.src_seq == b.src_seq && a.order < b.order);
+                      });
+            for (auto &s : staged) {
+                // skip events cancelled within the batch
+                if (slots[s.slot].gen == s.gen)
+                    queue.insert(Event{s.time, next_seq++, s.slot, s.gen});
+            }
+            staged.clear();
+        }
+
+    public:
+        Simulator() = default;
+        Simulator(const Simulator &) = delete;
+        Simulator &operator = (const Simulator &) = delete;
+        ~Simulator() {
+            stop_workers();
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+        double now() const noexcept {
+            return _now;
+        }
+
+        void set_threads(unsigned n) {
+            stop_workers();
+            for (unsigned i = 1; i < n; i++)
+                workers.emplace_back([this] { worker_loop(); });
+        }
+
+        Handle schedule(double t, Action a, uint64_t entity = NO_ENTITY) {
+            if (t < _now)
+                t = _now;
+            std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+            if (parallel_phase)
+                guard.lock();
+            uint32_t x = alloc_slot();
+            Slot &s = slots[x];
+            s.action = std::move(a);
+            s.entity = entity;
+            s.pending = true;
+            _size++;
+            if (parallel_phase)
+                staged.push_back(Staged{cur_seq, cur_order++, t, x, s.gen});
+            else
+                queue.insert(Event{t, next_seq++, x, s.gen});
+            return Handle{x, s.gen};
+        }
+
+        bool cancel(const Handle &h) {
+            std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+            if (parallel_phase)
+                guard.lock();
+            if (h.slot >= slots.size() || slots[h.slot].gen != h.gen
+                || !slots[h.slot].pending)
+                return false;
+            free_slot(h.slot);
+            _size--;
+            return true;
+        }
+
+        size_t step() {
+            // drop cancelled events and find next batch time
+            while (queue.size() > 0) {
+                const Event &e = queue.get_min();
+                if (slots[e.slot].gen == e.gen)
+                    break;
+                queue.pop();
+            }
+            if (queue.size() == 0)
+                return 0;
+            _now = queue.get_min().time;
+            batch.clear();
+            while (queue.size() > 0 && !(_now < queue.get_min().time)) {
+                Event e = queue.pop();
+                const Slot &s = slots[e.slot];
+                if (s.gen == e.gen)
+                    batch.push_back(Running{e.seq, s.entity, e.slot, e.gen});
+            }
+            size_t n = 0;
+            if (can_run_parallel()) {
+                ran = 0;
+                run_parallel();
+                n = ran;
+            } else {
+                for (auto &e : batch)
+                    n += run_event(e);
+            }
+            if (error) {
+                std::exception_ptr err = error;
+                error = nullptr;
+                std::rethrow_exception(err);
+            }
+            return n;
+        }
+
+        size_t run(double until = std::numeric_limits<double>::infinity()) {
+            size_t total = 0;
+            for (;;) {
+                while (queue.size() > 0) {
+                    const Event &e = queue.get_min();
+                    if (slots[e.slot].gen == e.gen)
+                        break;
+                    queue.pop();
+                }
+                if (queue.size() == 0 || until < queue.get_min().time)
+                    break;
+                total += step();
+            }
+            return total;
+        }
+    };
+}
+
+#endif // _ALG_SIMULATOR
@@ -0,0 +1,331 @@
+/*
+* Soft Heap Implementation (Kaplan, Tarjan and Zwick simplified version)
+* SoftHeap<T, Compare> - heap with error rate eps: an element may be
+*   corrupted, i.e. pop() treats it as if its key were raised to the
+*   corrupted key of the list it sits in; at most eps * N of N inserted
+*   elements are corrupted at any time
+*   binary trees of ranks are kept in a root list like binomial trees,
+*   every node holds a list of elements with a common corrupted key,
+*   nodes above rank lg(1/eps) + 4 are refilled up to sizes growing by
+*   3/2 per rank, which keeps pops cheap and corruption bounded
+* Methods:
+*   1. SoftHeap(double eps = 0.1) - eps in (0, 1]
+*   2. size_t size(), bool empty(), void clear()
+*   3. void insert(const T &d)
+*       complexity: O(1) amortized
+*   4. const T &get_min() - element next pop returns
+*       complexity: O(1)
+*   5. T pop(), T pop(T &ckey) - pop element with the smallest corrupted
+*       key, ckey >= returned element receives that key
+*       T needs no default constructor
+*       complexity: O(lg(1/eps)) amortized, plus a walk over the roots
+*       before the popped one, at most lg(N), when its list runs out
+* soft_select(first, nth, last[, comp]) - like std::nth_element:
+*   quickselect with median-of-3 pivots; after lg(N) steps that keep more
+*   than 3/4 of the range, pivots are the largest of N/3 elements popped
+*   from a soft heap with eps = 1/3, whose rank is in [N/3, 2N/3]
+*   complexity: O(N) on average, about as fast as std::nth_element;
+*   O(N lg(N)) worst case, since the soft heap pivot pays the root walk
+*   on up to N/3 pops; never quadratic, but an input built against the
+*   median-of-3 pivots runs about 20 times slower than a random one
+* soft_sort(first, last, eps[, comp]) - approximate sort, elements are
+*   written in the order a soft heap with eps pops them; every element is
+*   followed by at most eps * N smaller ones, eps < 1/N sorts exactly
+*   complexity: O(N lg(1/eps))
+*/
+#ifndef _ALG_SOFT_HEAP
+#define _ALG_SOFT_HEAP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T, typename Compare = std::less<T>>
+    class SoftHeap {
+        static constexpr uint32_t NIL = UINT32_MAX;
+        static constexpr unsigned MAX_RANK = 64;
+
+        struct Item {
+            T key;
+            uint32_t next;
+        };
+        struct Node {
+            T ckey;          // corrupted key, >= keys of items in list
+            uint32_t head;   // item list
+            uint32_t tail;
+            uint32_t count;
+            uint32_t left;
+            uint32_t right;
+            uint32_t next;   // root list, increasing ranks
+            uint32_t smin;   // root with the smallest ckey from here on
+            uint32_t rank;
+        };
+
+        std::vector<Item> items;
+        std::vector<uint32_t> free_items;
+        std::vector<Node> nodes;
+        std::vector<uint32_t> free_nodes;
+        size_t target[MAX_RANK];  // list size a node of rank k is refilled to
+        uint32_t root = NIL;
+        size_t _size = 0;
+        Compare comp;
+
+        uint32_t alloc_item(const T &d) {
+            if (!free_items.empty()) {
+                uint32_t x = free_items.back();
+                free_items.pop_back();
+                items[x] = Item{d, NIL};
+                return x;
+            }
+            items.push_back(Item{d, NIL});
+            return uint32_t(items.size() - 1);
+        }
+        // Node is built from a key, T needs no default constructor
+        uint32_t alloc_node(const T &ckey) {
+            if (!free_nodes.empty()) {
+                uint32_t x = free_nodes.back();
+                free_nodes.pop_back();
+                nodes[x].ckey = ckey;
+                return x;
+            }
+            nodes.push_back(Node{ckey, NIL, NIL, 0, NIL, NIL, NIL, NIL, 0});
+            return uint32_t(nodes.size() - 1);
+        }
+
+        bool leaf(uint32_t x) const {
+            return nodes[x].left == NIL && nodes[x].right == NIL;
+        }
+
+        // move lists up from children until list of x reaches its target size
+        void sift(uint32_t x) {
+            while (nodes[x].count < target[nodes[x].rank] && !leaf(x)) {
+                uint32_t l = nodes[x].left, r = nodes[x].right;
+                if (l == NIL || (r != NIL && comp(nodes[r].ckey, nodes[l].ckey))) {
+                    nodes[x].left = r;
+                    nodes[x].right = l;
+                    l = r;
+                }
+                Node &p = nodes[x];
+                Node &c = nodes[l];
+                if (p.head == NIL)
+                    p.head = c.head;
+                else
+                    items[p.tail].next = c.head;
+                p.tail = c.tail;
+                p.count += c.count;
+                p.ckey = c.ckey;
+                c.head = c.tail = NIL;
+                c.count = 0;
+                if (leaf(l)) {
+                    nodes[x].left = NIL;
+                    free_nodes.push_back(l);
+                } else {
+                    sift(l);
+                }
+            }
+        }
+
+        uint32_t combine(uint32_t x, uint32_t y) {
+            uint32_t z = alloc_node(nodes[x].ckey);
+            Node &n = nodes[z];
+            n.head = n.tail = NIL;
+            n.count = 0;
+            n.left = x;
+            n.right = y;
+            n.rank = nodes[x].rank + 1;
+            sift(z);
+            return z;
+        }
+
+        void update_smin(uint32_t x) {
+            Node &n = nodes[x];
+            n.smin = x;
+            if (n.next != NIL && comp(nodes[nodes[n.next].smin].ckey, n.ckey))
+                n.smin = nodes[n.next].smin;
+        }
+
+        // ckey may be null
+        T pop_item(T *ckey) {
+            if (_size == 0)
+                throw std::out_of_range("Pop from empty SoftHeap");
+            uint32_t h = nodes[root].smin;
+            Node &n = nodes[h];
+            if (ckey)
+                *ckey = n.ckey;
+            uint32_t it = n.head;
+            T res = std::move(items[it].key);
+            n.head = items[it].next;
+            if (n.head == NIL)
+                n.tail = NIL;
+            n.count--;
+            free_items.push_back(it);
+            _size--;
+            if (n.count > 0)
+                return res;
+            // list ran out: refill or drop h, then fix smin of roots before it
+            uint32_t before[MAX_RANK];
+            unsigned k = 0;
+            for (uint32_t r = root; r != h; r = nodes[r].next)
+                before[k++] = r;
+            if (leaf(h)) {
+                if (k == 0)
+                    root = nodes[h].next;
+                else
+                    nodes[before[k - 1]].next = nodes[h].next;
+                free_nodes.push_back(h);
+            } else {
+                sift(h);
+                update_smin(h);
+            }
+            while (k > 0)
+                update_smin(before[--k]);
+            return res;
+        }
+
+    public:
+        explicit SoftHeap(double eps = 0.1, Compare c = Compare()) : comp(c) {
+            if (!(eps > 0 && eps <= 1))
+                throw std::invalid_argument("SoftHeap eps must be in (0, 1]");
+            // corrupted elements <= 9N / 2^t, so 2^(t - 4) >= 1/eps is enough
+            unsigned t = 4;
+            while (t < MAX_RANK - 1 && double(uint64_t(1) << (t - 4)) < 1 / eps)
+                t++;
+            for (unsigned k = 0; k < MAX_RANK; k++) {
+                if (k <= t)
+                    target[k] = 1;
+                else if (target[k - 1] > SIZE_MAX / 3)
+                    target[k] = SIZE_MAX;
+                else
+                    target[k] = (3 * target[k - 1] + 1) / 2;
+            }
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+        bool empty() const noexcept {
+            return _size == 0;
+        }
+        void clear() {
+            items.clear();
+            free_items.clear();
+            nodes.clear();
+            free_nodes.clear();
+            root = NIL;
+            _size = 0;
+        }
+
+        void insert(const T &d) {
+            uint32_t it = alloc_item(d);
+            uint32_t x = alloc_node(d);
+            Node &n = nodes[x];
+            n.head = n.tail = it;
+            n.count = 1;
+            n.left = n.right = NIL;
+            n.rank = 0;
+            // binary counter over the root list
+            while (root != NIL && nodes[root].rank == nodes[x].rank) {
+                uint32_t y = root;
+                root = nodes[y].next;
+                x = combine(x, y);
+            }
+            nodes[x].next = root;
+            root = x;
+            update_smin(x);
+            _size++;
+        }
+
+        const T &get_min() const {
+            if (_size == 0)
+                throw std::out_of_range("get_min from empty SoftHeap");
+            return items[nodes[nodes[root].smin].head].key;
+        }
+
+        T pop(T &ckey) {
+            return pop_item(&ckey);
+        }
+        T pop() {
+            return pop_item(nullptr);
+        }
+    };
+
+    namespace soft {
+        template <typename T, typename Compare>
+        T median3(const T &a, const T &b, const T &c, Compare &comp) {
+            if (comp(a, b))
+                return comp(b, c) ? b : comp(a, c) ? c : a;
+            return comp(a, c) ? a : comp(b, c) ? c : b;
+        }
+
+        // largest of N/3 smallest corrupted keys, at most N/3 remaining
+        // elements are corrupted, others are not smaller
+        template <typename T, typename It, typename Compare>
+        T pivot(SoftHeap<T, Compare> &heap, It first, It last, Compare &comp) {
+            heap.clear();
+            for (It i = first; i != last; ++i)
+                heap.insert(*i);
+            T p = heap.pop();
+            for (ptrdiff_t j = (last - first) / 3; j > 1; j--) {
+                T x = heap.pop();
+                if (comp(p, x))
+                    p = std::move(x);
+            }
+            return p;
+        }
+    }
+
+    template <typename It, typename Compare>
+    void soft_select(It first, It nth, It last, Compare comp) {
+        using T = typename std::iterator_traits<It>::value_type;
+        constexpr ptrdiff_t CUTOFF = 64;
+        if (nth == last)
+            return;
+        SoftHeap<T, Compare> heap(1.0 / 3, comp);
+        int bad = 0, budget = 0;
+        for (ptrdiff_t n = last - first; n > 1; n >>= 1)
+            budget++;
+        while (last - first > CUTOFF) {
+            ptrdiff_t n = last - first;
+            T pivot = bad < budget
+                ? soft::median3(*first, *(first + n / 2), *(last - 1), comp)
+                : soft::pivot(heap, first, last, comp);
+            It lt = std::partition(first, last, [&](const T &a) { return comp(a, pivot); });
+            It gt = std::partition(lt, last, [&](const T &a) { return !comp(pivot, a); });
+            if (nth < lt)
+                last = lt;
+            else if (nth < gt)
+                return;
+            else
+                first = gt;
+            if (4 * (last - first) > 3 * n)
+                bad++;
+        }
+        std::sort(first, last, comp);
+    }
+    template <typename It>
+    void soft_select(It first, It nth, It last) {
+        soft_select(first, nth, last, std::less<typename std::iterator_traits<It>::value_type>());
+    }
+
+    template <typename It, typename Compare>
+    void soft_sort(It first, It last, double eps, Compare comp) {
+        using T = typename std::iterator_traits<It>::value_type;
+        SoftHeap<T, Compare> heap(eps, comp);
+        for (It i = first; i != last; ++i)
+            heap.insert(*i);
+        for (It i = first; i != last; ++i)
+            *i = heap.pop();
+    }
+    template <typename It>
+    void soft_sort(It first, It last, double eps) {
+        soft_sort(first, last, eps, std::less<typename std::iterator_traits<It>::value_type>());
+    }
+}
+
+#endif // _ALG_SOFT_HEAP
@@ -0,0 +1,264 @@
+/*
+* Hierarchical Timing Wheel Implementation
+* TimerWheel<T, OverflowHeap> - timer queue keyed by integer ticks
+*   Near-term deadlines (less than 2^32 ticks ahead) live in 4 wheel levels
+*   of 256 slots each, far-future deadlines are kept in OverflowHeap
+*   (FibHeap by default, Bheap also fits) and cascaded into the wheel
+*   as time advances.
+* TimerWheel<T>::Handle - returned by schedule, required only for cancel
+* T needn't be default constructible, its copy is released when the timer
+* fires or is cancelled
+* Methods:
+*   1. size_t size() - number of pending timers
+*   2. uint64_t now() - current tick
+*   3. Handle schedule(uint64_t deadline, const T &d) - add timer
+*       deadline <= now() fires on the next tick
+*       complexity: O(1) in wheel, OverflowHeap insert for far-future
+*   4. bool cancel(const Handle &h) - remove pending timer
+*       return false if timer already fired or cancelled
+*       complexity: O(1)
+*   5. size_t advance(uint64_t t, F &&on_expire) - move time to t,
+*       calls on_expire(uint64_t deadline, T &d) for every expired timer
+*       return number of expired timers
+*       NOTE: on_expire may schedule/cancel, but must not call advance;
+*       cancelling a timer of the same tick that hasn't fired yet stops it
+*       complexity: O(1) per tick and per expired timer, cascading is
+*       O(1) amortized per timer
+*
+* Cancelled far-future timers stay in OverflowHeap and are dropped lazily
+* when they reach the top.
+*/
+#ifndef _ALG_TIMER_WHEEL
+#define _ALG_TIMER_WHEEL
+
+#include <cstdint>
+#include <vector>
+#include <optional>
+#include <utility>
+#include "FibHeap.h"
+
+namespace alg {
+    template <typename T, template <typename> class OverflowHeap = FibHeap>
+    class TimerWheel {
+        static const unsigned LEVELS = 4;
+        static const unsigned SLOT_BITS = 8;
+        static const unsigned SLOTS = 1u << SLOT_BITS;
+        static const uint64_t SPAN = 1ull << (LEVELS * SLOT_BITS);
+        static const uint32_t NIL = UINT32_MAX;
+        static const uint16_t IN_OVERFLOW = LEVELS * SLOTS;
+        static const uint16_t FREE = LEVELS * SLOTS + 1;
+        static const uint16_t EXPIRED = LEVELS * SLOTS + 2;  // due, on_expire not called yet
+
+        struct Node {
+            uint64_t deadline;
+            uint32_t prev;
+            uint32_t next;
+            uint32_t gen = 0;
+            uint16_t bucket = FREE;
+            std::optional<T> data;  // empty while the node is free
+        };
+        struct OverflowEntry {
+            uint64_t deadline;
+            uint32_t idx;
+            uint32_t gen;
+            bool operator < (const OverflowEntry &r) const {
+                return deadline < r.deadline;
+            }
+        };
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> free_nodes;
+        uint32_t slots[LEVELS * SLOTS];
+        OverflowHeap<OverflowEntry> overflow;
+        std::vector<std::pair<uint32_t, uint32_t>> expired;  // node, gen
+        uint64_t _now;
+        size_t _size = 0;
+        size_t level_size[LEVELS] = {};
+
+        uint32_t alloc_node() {
+            if (!free_nodes.empty()) {
+                uint32_t x = free_nodes.back();
+                free_nodes.pop_back();
+                return x;
+            }
+            nodes.emplace_back();
+            return uint32_t(nodes.size() - 1);
+        }
+        void free_node(uint32_t x) {
+            nodes[x].bucket = FREE;
+            nodes[x].gen++;
+            nodes[x].data.reset();
+            free_nodes.push_back(x);
+        }
+
+        void link(uint32_t x, uint16_t bucket) {
+            Node &n = nodes[x];
+            n.bucket = bucket;
+            n.prev = NIL;
+            n.next = slots[bucket];
+            if (n.next != NIL)
+                nodes[n.next].prev = x;
+            slots[bucket] = x;
+            level_size[bucket / SLOTS]++;
+        }
+        void unlink(uint32_t x) {
+            Node &n = nodes[x];
+            if (n.prev != NIL)
+                nodes[n.prev].next = n.next;
+            else
+                slots[n.bucket] = n.next;
+            if (n.next != NIL)
+                nodes[n.next].prev = n.prev;
+            level_size[n.bucket / SLOTS]--;
+        }
+
+        // place node relative to _now, deadline must be > _now - 1
+        void place(uint32_t x) {
+            uint64_t deadline = nodes[x].deadline;
+            uint64_t delta = deadline - _now;
+            if (delta >= SPAN) {
+                nodes[x].bucket = IN_OVERFLOW;
+                overflow.insert(OverflowEntry{deadline, x, nodes[x].gen});
+                return;
+            }
+            unsigned level = 0;
+            while (delta >= (1ull << ((level + 1) * SLOT_BITS)))
+                level++;
+            unsigned slot = (deadline >> (level * SLOT_BITS)) & (SLOTS - 1);
+            link(x, uint16_t(level * SLOTS + slot));
+        }
+
+        void cascade(uint16_t bucket) {
+            uint32_t x = slots[bucket];
+            slots[bucket] = NIL;
+            while (x != NIL) {
+                uint32_t next = nodes[x].next;
+                level_size[bucket / SLOTS]--;
+                place(x);
+                x = next;
+            }
+        }
+
+        void pull_overflow() {
+            while (overflow.size() > 0) {
+                const OverflowEntry &e = overflow.get_min();
+                if (e.deadline - _now >= SPAN && e.deadline > _now)
+                    return;
+                OverflowEntry top = overflow.pop();
+                if (nodes[top.idx].gen != top.gen)
+                    continue; // cancelled
+                place(top.idx);
+            }
+        }
+
+        void collect(uint16_t bucket) {
+            uint32_t x = slots[bucket];
+            slots[bucket] = NIL;
+            while (x != NIL) {
+                uint32_t next = nodes[x].next;
+                level_size[0]--;
+                nodes[x].bucket = EXPIRED;
+                expired.emplace_back(x, nodes[x].gen);
+                x = next;
+            }
+        }
+
+        void tick() {
+            _now++;
+            for (unsigned level = LEVELS - 1; level > 0; level--) {
+                uint64_t mask = (1ull << (level * SLOT_BITS)) - 1;
+                if ((_now & mask) == 0) {
+                    unsigned slot = (_now >> (level * SLOT_BITS)) & (SLOTS - 1);
+                    cascade(uint16_t(level * SLOTS + slot));
+                }
+            }
+            pull_overflow();
+            collect(uint16_t(_now & (SLOTS - 1)));
+        }
+
+    public:
+        struct Handle {
+            uint32_t idx = NIL;
+            uint32_t gen = 0;
+        };
+
+        explicit TimerWheel(uint64_t start = 0) : _now(start) {
+            for (auto &s : slots)
+                s = NIL;
+        }
+        size_t size() const noexcept {
+            return _size;
+        }
+        uint64_t now() const noexcept {
+            return _now;
+        }
+
+        Handle schedule(uint64_t deadline, const T &d) {
+            if (deadline <= _now)
+                deadline = _now + 1;
+            uint32_t x = alloc_node();
+            nodes[x].deadline = deadline;
+            nodes[x].data.emplace(d);
+            place(x);
+            _size++;
+            return Handle{x, nodes[x].gen};
+        }
+
+        bool cancel(const Handle &h) {
+            if (h.idx >= nodes.size())
+                return false;
+            Node &n = nodes[h.idx];
+            if (n.gen != h.gen || n.bucket == FREE)
+                return false;
+            if (n.bucket != IN_OVERFLOW && n.bucket != EXPIRED)
+                unlink(h.idx);
+            free_node(h.idx);
+            _size--;
+            return true;
+        }
+
+        template <typename F>
+        size_t advance(uint64_t t, F &&on_expire) {
+            size_t fired = 0;
+            while (_now < t) {
+                // skip ticks which can't fire or cascade anything
+                unsigned empty = 0;
+                while (empty < LEVELS && level_size[empty] == 0)
+                    empty++;
+                uint64_t jump = t;
+                if (empty > 0 && empty < LEVELS) {
+                    uint64_t mask = (1ull << (empty * SLOT_BITS)) - 1;
+                    uint64_t boundary = (_now | mask) + 1;
+                    if (boundary < jump)
+                        jump = boundary;
+                }
+                if (overflow.size() > 0) {
+                    uint64_t first = overflow.get_min().deadline;
+                    if (first >= SPAN && first - SPAN < jump)
+                        jump = first - SPAN + 1;
+                }
+                if (empty > 0 && jump - 1 > _now) {
+                    _now = jump - 1;
+                    pull_overflow();
+                    continue;
+                }
+                tick();
+                for (auto &e : expired) {
+                    Node &n = nodes[e.first];
+                    if (n.gen != e.second)
+                        continue; // cancelled by an earlier on_expire of this tick
+                    uint64_t deadline = n.deadline;
+                    T d = std::move(*n.data);
+                    free_node(e.first);
+                    _size--;
+                    on_expire(deadline, d);
+                    fired++;
+                }
+                expired.clear();
+            }
+            return fired;
+        }
+    };
+}
+
+#endif // _ALG_TIMER_WHEEL
@@ -0,0 +1,155 @@
+/*
+* Bounded Top-K Selector
+* TopK<T, Compare> - keeps K greatest elements of a stream (by Compare,
+*   std::less by default, pass std::greater to keep K smallest)
+*   elements live in a fixed-size array min-heap, root is the worst kept
+*   element, so a new element is compared against root before insertion
+* Methods:
+*   1. size_t size() - number of kept elements, at most K
+*   2. size_t capacity() - K
+*   3. const T &threshold() - worst kept element
+*       complexity: O(1)
+*   4. bool push(const T &d) - offer element, return true if it was kept
+*       complexity: O(1) if rejected, O(lg(K)) otherwise
+*   5. void push_batch(const T *d, size_t n) - offer n elements
+*       blocks of elements are prefiltered against root with a branchless
+*       loop, which compiler vectorizes for arithmetic T
+*       complexity: O(n) + O(lg(K)) for each kept element
+*   6. void merge(const TopK &r) - combine with selector of other thread
+*       complexity: O(K lg(K))
+*   7. std::vector<T> sorted() const - kept elements, best first
+*      void sorted(std::vector<T> &out) const - same into reused buffer
+*       complexity: O(K lg(K))
+*   8. void clear()
+*/
+#ifndef _ALG_TOP_K
+#define _ALG_TOP_K
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace alg {
+    template <typename T, typename Compare = std::less<T>>
+    class TopK {
+        static constexpr size_t BLOCK = 32;
+
+        std::vector<T> heap;
+        size_t k;
+        Compare comp;
+
+        // min-heap by comp: heap[0] is the worst kept element
+        void sift_up(size_t i) {
+            T x = std::move(heap[i]);
+            while (i > 0) {
+                size_t p = (i - 1) / 2;
+                if (!comp(x, heap[p]))
+                    break;
+                heap[i] = std::move(heap[p]);
+                i = p;
+            }
+            heap[i] = std::move(x);
+        }
+        void sift_down(size_t i) {
+            size_t n = heap.size();
+            T x = std::move(heap[i]);
+            for (;;) {
+                size_t c = 2 * i + 1;
+                if (c >= n)
+                    break;
+                if (c + 1 < n && comp(heap[c + 1], heap[c]))
+                    c++;
+                if (!comp(heap[c], x))
+                    break;
+                heap[i] = std::move(heap[c]);
+                i = c;
+            }
+            heap[i] = std::move(x);
+        }
+
+        // heap is full, d is better than root
+        void replace_root(const T &d) {
+            heap[0] = d;
+            sift_down(0);
+        }
+
+    public:
+        explicit TopK(size_t K, Compare c = Compare()) : k(K), comp(c) {
+            if (K == 0)
+                throw std::invalid_argument("TopK capacity must be positive");
+            heap.reserve(K);
+        }
+
+        size_t size() const noexcept {
+            return heap.size();
+        }
+        size_t capacity() const noexcept {
+            return k;
+        }
+        const T &threshold() const {
+            if (heap.empty())
+                throw std::out_of_range("threshold of empty TopK");
+            return heap[0];
+        }
+
+        bool push(const T &d) {
+            if (heap.size() < k) {
+                heap.push_back(d);
+                sift_up(heap.size() - 1);
+                return true;
+            }
+            if (!comp(heap[0], d))
+                return false;
+            replace_root(d);
+            return true;
+        }
+
+        void push_batch(const T *d, size_t n) {
+            size_t i = 0;
+            while (i < n && heap.size() < k)
+                push(d[i++]);
+            for (; i + BLOCK <= n; i += BLOCK) {
+                const T thr = heap[0];
+                unsigned any = 0;
+                for (size_t j = 0; j < BLOCK; j++)
+                    any |= unsigned(comp(thr, d[i + j]));
+                if (!any)
+                    continue;
+                for (size_t j = 0; j < BLOCK; j++) {
+                    if (comp(heap[0], d[i + j]))
+                        replace_root(d[i + j]);
+                }
+            }
+            for (; i < n; i++)
+                push(d[i]);
+        }
+        template <typename It>
+        void push_batch(It first, It last) {
+            for (; first != last; ++first)
+                push(*first);
+        }
+
+        void merge(const TopK &r) {
+            push_batch(r.heap.data(), r.heap.size());
+        }
+
+        std::vector<T> sorted() const {
+            std::vector<T> res;
+            sorted(res);
+            return res;
+        }
+        void sorted(std::vector<T> &out) const {
+            out.assign(heap.begin(), heap.end());
+            std::sort(out.begin(), out.end(),
+                      [this](const T &a, const T &b) { return comp(b, a); });
+        }
+
+        void clear() noexcept {
+            heap.clear();
+        }
+    };
+}
+
+#endif // _ALG_TOP_K
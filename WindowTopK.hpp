@@ -0,0 +1,247 @@
+/*
+* Sliding Window Top-K with Timestamp Expiry
+* WindowTopK<Key, Score, Hash> - K items with the largest score over the
+*   last W time units; an item's score is the sum of its events in the
+*   window, every event expires W after its timestamp
+*   items are split between two addressable MinMaxHeaps: the K best ones
+*   and the rest, so a score change or removal only exchanges the worst
+*   of the top with the best of the rest
+*   events wait for expiry in a FIFO while timestamps arrive in order,
+*   late events go to a binary heap ordered by timestamp
+*   an item is erased when its last event expires, equal scores rank
+*   the item that entered the window first higher
+* Methods:
+*   1. WindowTopK(uint64_t window, size_t k)
+*   2. size_t size() - items with events in the window, size_t events()
+*      uint64_t now() - latest timestamp seen
+*   3. bool add(const Key &key, Score delta, uint64_t time) - add event,
+*       delta may be negative; time > now() expires older events first;
+*       return false if event is already out of the window
+*       complexity: O(lg(N)) amortized, late events add O(lg(E))
+*   4. size_t expire(uint64_t now) - drop events with time <= now - W,
+*       return number of dropped events
+*       complexity: O(lg(N)) per dropped event
+*   5. bool contains(const Key &key), Score score(const Key &key)
+*   6. void top(std::vector<Item> &out) - top items, best first
+*       complexity: O(K lg(K))
+*   7. static void merge(const std::vector<const WindowTopK *> &shards,
+*                        size_t k, std::vector<Item> &out)
+*       global top k of shards, scores of equal keys are summed; exact
+*       when shards partition keys, expire shards to the same time first
+*       complexity: O(S K lg(S K))
+*/
+#ifndef _ALG_WINDOW_TOP_K
+#define _ALG_WINDOW_TOP_K
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "MinMaxHeap.hpp"
+
+namespace alg {
+    template <typename Key, typename Score = double, typename Hash = std::hash<Key>>
+    class WindowTopK {
+    public:
+        struct Item {
+            Key key;
+            Score score;
+        };
+
+    private:
+        struct Priority {
+            Score score;
+            uint64_t seq;   // item that entered the window first wins ties
+            uint32_t slot;
+            bool operator < (const Priority &r) const {
+                return score < r.score || (score == r.score && seq > r.seq);
+            }
+        };
+        using Heap = MinMaxHeap<Priority>;
+
+        struct Entry {
+            Key key;
+            Score score;
+            uint64_t seq;
+            uint32_t events;
+            bool in_top;
+            typename Heap::Handle handle;
+        };
+        struct Event {
+            uint64_t time;
+            uint32_t slot;
+            Score delta;
+            bool operator > (const Event &r) const {
+                return time > r.time;
+            }
+        };
+
+        uint64_t window;
+        size_t k;
+        uint64_t _now = 0;
+        uint64_t next_seq = 0;
+        Heap best;   // at most k items, min is the worst of them
+        Heap rest;   // max is the best item outside of top
+        std::vector<Entry> slots;
+        std::vector<uint32_t> free_slots;
+        std::unordered_map<Key, uint32_t, Hash> index;
+        std::deque<Event> fifo;
+        std::vector<Event> late;  // min heap by time
+
+        void move(uint32_t x) {
+            Entry &e = slots[x];
+            Heap &from = e.in_top ? best : rest;
+            Heap &to = e.in_top ? rest : best;
+            from.erase(e.handle);
+            e.handle = to.insert(Priority{e.score, e.seq, x});
+            e.in_top = !e.in_top;
+        }
+
+        void rebalance() {
+            while (best.size() < k && !rest.empty())
+                move(rest.get_max().slot);
+            while (!rest.empty() && best.get_min() < rest.get_max()) {
+                uint32_t a = best.get_min().slot;
+                move(rest.get_max().slot);
+                move(a);
+            }
+        }
+
+        void apply(const Event &ev) {
+            Entry &e = slots[ev.slot];
+            e.score -= ev.delta;
+            Heap &h = e.in_top ? best : rest;
+            if (--e.events == 0) {
+                h.erase(e.handle);
+                index.erase(e.key);
+                free_slots.push_back(ev.slot);
+            } else {
+                h.update(e.handle, Priority{e.score, e.seq, ev.slot});
+            }
+            rebalance();
+        }
+
+    public:
+        WindowTopK(uint64_t window, size_t k) : window(window), k(k) {
+            if (window == 0 || k == 0)
+                throw std::invalid_argument("WindowTopK window and k must be positive");
+        }
+
+        size_t size() const noexcept {
+            return index.size();
+        }
+        size_t events() const noexcept {
+            return fifo.size() + late.size();
+        }
+        uint64_t now() const noexcept {
+            return _now;
+        }
+
+        size_t expire(uint64_t now) {
+            if (now > _now)
+                _now = now;
+            if (_now < window)
+                return 0;
+            uint64_t limit = _now - window;
+            size_t dropped = 0;
+            while (!fifo.empty() && fifo.front().time <= limit) {
+                Event ev = fifo.front();
+                fifo.pop_front();
+                apply(ev);
+                dropped++;
+            }
+            while (!late.empty() && late.front().time <= limit) {
+                std::pop_heap(late.begin(), late.end(), std::greater<Event>());
+                Event ev = late.back();
+                late.pop_back();
+                apply(ev);
+                dropped++;
+            }
+            return dropped;
+        }
+
+        bool add(const Key &key, Score delta, uint64_t time) {
+            if (time > _now)
+                expire(time);
+            if (_now >= window && time <= _now - window)
+                return false;
+            uint32_t x;
+            auto it = index.find(key);
+            if (it != index.end()) {
+                x = it->second;
+                Entry &e = slots[x];
+                e.score += delta;
+                e.events++;
+                (e.in_top ? best : rest).update(e.handle, Priority{e.score, e.seq, x});
+            } else {
+                if (!free_slots.empty()) {
+                    x = free_slots.back();
+                    free_slots.pop_back();
+                    slots[x].key = key;
+                } else {
+                    x = uint32_t(slots.size());
+                    slots.push_back(Entry{key, delta, 0, 0, false, {}});
+                }
+                Entry &e = slots[x];
+                e.score = delta;
+                e.seq = next_seq++;
+                e.events = 1;
+                e.in_top = false;
+                e.handle = rest.insert(Priority{delta, e.seq, x});
+                index.emplace(key, x);
+            }
+            rebalance();
+            if (fifo.empty() || fifo.back().time <= time) {
+                fifo.push_back(Event{time, x, delta});
+            } else {
+                late.push_back(Event{time, x, delta});
+                std::push_heap(late.begin(), late.end(), std::greater<Event>());
+            }
+            return true;
+        }
+
+        bool contains(const Key &key) const {
+            return index.count(key) != 0;
+        }
+        Score score(const Key &key) const {
+            auto it = index.find(key);
+            return it == index.end() ? Score() : slots[it->second].score;
+        }
+
+        void top(std::vector<Item> &out) const {
+            std::vector<Priority> p;
+            p.reserve(best.size());
+            best.for_each([&p](const Priority &d) { p.push_back(d); });
+            std::sort(p.begin(), p.end(), [](const Priority &a, const Priority &b) { return b < a; });
+            out.clear();
+            for (const Priority &d : p)
+                out.push_back(Item{slots[d.slot].key, d.score});
+        }
+
+        static void merge(const std::vector<const WindowTopK *> &shards, size_t k,
+                          std::vector<Item> &out) {
+            std::unordered_map<Key, Score, Hash> sum;
+            std::vector<Item> part;
+            for (const WindowTopK *s : shards) {
+                s->top(part);
+                for (const Item &it : part)
+                    sum[it.key] += it.score;
+            }
+            out.clear();
+            for (auto &kv : sum)
+                out.push_back(Item{kv.first, kv.second});
+            auto better = [](const Item &a, const Item &b) { return b.score < a.score; };
+            if (out.size() > k) {
+                std::nth_element(out.begin(), out.begin() + k, out.end(), better);
+                out.erase(out.begin() + k, out.end());
+            }
+            std::sort(out.begin(), out.end(), better);
+        }
+    };
+}
+
+#endif // _ALG_WINDOW_TOP_K
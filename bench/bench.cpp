@@ -0,0 +1,852 @@
+/*
+* Benchmark driver
+*   bench [name ...] - run named benchmarks, all of them by default
+*   every line reports ns per operation and operations per second
+*/
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "CalendarQueue.hpp"
+#include "Bheap.hpp"
+#include "FibHeap.h"
+#include "Simulator.hpp"
+#include "KWayMerge.hpp"
+#include "ExternalSort.hpp"
+#include "QueueServer.hpp"
+#include "SearchQueues.hpp"
+#include "OrderBook.hpp"
+#include "CostCache.hpp"
+#include "LeastLoaded.hpp"
+#include "HuffmanCode.hpp"
+#include "SoftHeap.hpp"
+#include "TopK.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point t) {
+        return std::chrono::duration<double>(Clock::now() - t).count();
+    }
+    void report(const char *name, size_t ops, double sec) {
+        std::printf("%-44s %10.1f ns/op %14.0f ops/s\n", name,
+                    1e9 * sec / double(ops), double(ops) / sec);
+    }
+
+    // hold model: pop the next event, schedule it again a random delay later
+    template <typename Queue>
+    void hold(const char *name, size_t n, size_t ops) {
+        std::mt19937_64 rng(1);
+        std::exponential_distribution<double> delay(1.0);
+        std::vector<double> inc(1 << 16);
+        for (auto &d : inc)
+            d = delay(rng);
+        Queue q;
+        for (size_t i = 0; i < n; i++)
+            q.insert(inc[i & (inc.size() - 1)]);
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; i++) {
+            double t = q.pop();
+            q.insert(t + inc[i & (inc.size() - 1)]);
+        }
+        report(name, ops, seconds_since(start));
+    }
+
+    // all events at one time: insert a burst, then drain it
+    template <typename Queue>
+    void burst(const char *name, size_t n) {
+        Queue q;
+        auto start = Clock::now();
+        for (size_t i = 0; i < n; i++)
+            q.insert(1.0);
+        while (q.size() > 0)
+            q.pop();
+        report(name, 2 * n, seconds_since(start));
+    }
+
+    void bench_calendar() {
+        for (size_t n : {size_t(1000), size_t(100000), size_t(1000000)}) {
+            char name[64];
+            std::snprintf(name, sizeof(name), "hold n=%zu CalendarQueue", n);
+            hold<alg::CalendarQueue<double>>(name, n, 2000000);
+            std::snprintf(name, sizeof(name), "hold n=%zu Bheap", n);
+            hold<alg::Bheap<double>>(name, n, 2000000);
+            std::snprintf(name, sizeof(name), "hold n=%zu FibHeap", n);
+            hold<alg::FibHeap<double>>(name, n, 2000000);
+        }
+        burst<alg::CalendarQueue<double>>("same-time burst n=1000000 CalendarQueue", 1000000);
+    }
+
+    // simulator hold model: n self-rescheduling events, ops events run
+    template <template <typename...> class Queue>
+    void sim_hold(const char *name, size_t n, size_t ops) {
+        using Sim = alg::Simulator<Queue>;
+        std::mt19937_64 rng(1);
+        std::exponential_distribution<double> delay(1.0);
+        std::vector<double> inc(1 << 16);
+        for (auto &d : inc)
+            d = delay(rng);
+        Sim sim;
+        size_t done = 0;
+        std::function<void(Sim &)> again = [&](Sim &s) {
+            if (++done < ops)
+                s.schedule(s.now() + inc[done & (inc.size() - 1)], again);
+        };
+        for (size_t i = 0; i < n; i++)
+            sim.schedule(inc[i & (inc.size() - 1)], again);
+        auto start = Clock::now();
+        size_t ran = sim.run();
+        report(name, ran, seconds_since(start));
+    }
+
+    // same-time batches of n events on 64 entities, each event does some work
+    void sim_batches(const char *name, size_t n, unsigned threads) {
+        using Sim = alg::Simulator<>;
+        Sim sim;
+        sim.set_threads(threads);
+        std::vector<uint64_t> acc(64 * 8, 0);
+        size_t events = 0;
+        for (int round = 0; round < 10; round++) {
+            for (size_t i = 0; i < n; i++) {
+                uint64_t e = i % 64;
+                sim.schedule(double(round), [&acc, e](Sim &) {
+                    uint64_t x = acc[e * 8] + 1;
+                    for (int k = 0; k < 200; k++)
+                        x = x * 6364136223846793005ull + 1442695040888963407ull;
+                    acc[e * 8] = x;
+                }, e);
+            }
+            events += n;
+        }
+        auto start = Clock::now();
+        sim.run();
+        report(name, events, seconds_since(start));
+    }
+
+    void bench_simulator() {
+        sim_hold<alg::CalendarQueue>("simulator hold n=100000 CalendarQueue", 100000, 2000000);
+        sim_hold<alg::Bheap>("simulator hold n=100000 Bheap", 100000, 2000000);
+        sim_hold<alg::FibHeap>("simulator hold n=100000 FibHeap", 100000, 2000000);
+        sim_batches("simulator batches of 100000, 1 thread", 100000, 1);
+        sim_batches("simulator batches of 100000, 4 threads", 100000, 4);
+    }
+
+    struct CountingLess {
+        size_t *count;
+        bool operator () (uint64_t a, uint64_t b) const {
+            ++*count;
+            return a < b;
+        }
+    };
+
+    void bench_kway() {
+        using Run = alg::IteratorRun<std::vector<uint64_t>::const_iterator>;
+        std::mt19937_64 rng(1);
+        const size_t total = 4000000;
+        for (size_t k : {size_t(2), size_t(16), size_t(128), size_t(1000)}) {
+            std::vector<std::vector<uint64_t>> data(k);
+            for (size_t i = 0; i < total; i++)
+                data[rng() % k].push_back(rng() >> 1);
+            for (auto &d : data)
+                std::sort(d.begin(), d.end());
+            std::vector<Run> runs;
+            for (auto &d : data)
+                runs.emplace_back(d.cbegin(), d.cend());
+            size_t count = 0;
+            alg::LoserTree<Run, CountingLess> tree(runs, CountingLess{&count});
+            count = 0;
+            std::vector<uint64_t> out(total);
+            auto start = Clock::now();
+            tree.pop_all(out.begin());
+            double sec = seconds_since(start);
+            char name[64];
+            std::snprintf(name, sizeof(name), "loser tree k=%zu, %.2f cmp/elem", k,
+                          double(count) / double(total));
+            report(name, total, sec);
+
+            // same merge with a Bheap of cursors
+            struct Cursor {
+                uint64_t key;
+                uint32_t run;
+                bool operator < (const Cursor &r) const {
+                    return key < r.key || (key == r.key && run < r.run);
+                }
+            };
+            std::vector<size_t> pos(k, 0);
+            alg::Bheap<Cursor> heap;
+            for (size_t r = 0; r < k; r++) {
+                if (!data[r].empty())
+                    heap.insert(Cursor{data[r][0], uint32_t(r)});
+            }
+            start = Clock::now();
+            for (size_t i = 0; heap.size() > 0; i++) {
+                Cursor c = heap.pop();
+                out[i] = c.key;
+                if (++pos[c.run] < data[c.run].size())
+                    heap.insert(Cursor{data[c.run][pos[c.run]], c.run});
+            }
+            std::snprintf(name, sizeof(name), "Bheap of cursors k=%zu", k);
+            report(name, total, seconds_since(start));
+        }
+    }
+
+    long peak_rss_mb() {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        return ru.ru_maxrss / 1024;
+    }
+
+    // sorts 48M uint32 (192 MB) with a 32 MB budget through files in /tmp
+    void bench_extsort() {
+        const size_t n = size_t(48) << 20;
+        const size_t memory = size_t(32) << 20;
+        std::mt19937 rng(1);
+        alg::ExternalSorter<uint32_t> sorter(memory);
+        std::vector<uint32_t> buf(1 << 16);
+        auto start = Clock::now();
+        for (size_t done = 0; done < n; done += buf.size()) {
+            for (auto &x : buf)
+                x = rng();
+            sorter.push(buf.begin(), buf.end());
+        }
+        size_t runs = sorter.runs();
+        uint32_t prev = 0;
+        size_t out = 0;
+        bool sorted = true;
+        sorter.finish([&](const uint32_t *d, size_t cnt) {
+            for (size_t i = 0; i < cnt; i++) {
+                sorted &= prev <= d[i];
+                prev = d[i];
+            }
+            out += cnt;
+        });
+        double sec = seconds_since(start);
+        char name[96];
+        std::snprintf(name, sizeof(name), "external sort 192MB/32MB, %zu runs, %s", runs,
+                      sorted && out == n ? "ok" : "WRONG");
+        report(name, n, sec);
+        std::printf("%-44s %10.1f MB/s, peak RSS %ld MB\n", "",
+                    double(n * sizeof(uint32_t)) / sec / 1e6, peak_rss_mb());
+    }
+
+    // load generator: every client keeps depth batches in flight, requests
+    // alternate insert and pop, latency is from send() to its receive()
+    void queue_load(const std::string &path, size_t clients, size_t batch,
+                    size_t depth, size_t ops) {
+        std::vector<std::vector<double>> lat(clients);
+        std::vector<std::thread> threads;
+        auto start = Clock::now();
+        for (size_t c = 0; c < clients; c++) {
+            threads.emplace_back([&, c] {
+                alg::QueueClient<uint64_t> client(path);
+                std::mt19937_64 rng(c);
+                std::deque<Clock::time_point> sent;
+                size_t batches = ops / clients / batch, k = 0;
+                for (size_t b = 0; b < batches || !sent.empty(); b++) {
+                    if (b < batches) {
+                        for (size_t i = 0; i < batch; i++) {
+                            if (k++ % 2 == 0)
+                                client.insert(rng() % 1000000);
+                            else
+                                client.pop();
+                        }
+                        client.send();
+                        sent.push_back(Clock::now());
+                    }
+                    if (sent.size() == depth || (b >= batches && !sent.empty())) {
+                        client.receive();
+                        lat[c].push_back(seconds_since(sent.front()));
+                        sent.pop_front();
+                    }
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        double sec = seconds_since(start);
+        std::vector<double> all;
+        for (auto &l : lat)
+            all.insert(all.end(), l.begin(), l.end());
+        std::sort(all.begin(), all.end());
+        char name[96];
+        std::snprintf(name, sizeof(name), "queue server %zu clients, batch %zu, depth %zu",
+                      clients, batch, depth);
+        report(name, ops / clients / batch * clients * batch, sec);
+        std::printf("%-44s batch latency p50 %.1f us, p99 %.1f us\n", "",
+                    1e6 * all[all.size() / 2], 1e6 * all[all.size() * 99 / 100]);
+    }
+
+    void bench_queue_server() {
+        std::string path = "/tmp/alg_bench_" + std::to_string(getpid()) + ".sock";
+        alg::QueueServer<uint64_t> server(path);
+        std::thread loop([&] { server.run(); });
+        {
+            // 100k jobs in the queue, pops don't drain it
+            alg::QueueClient<uint64_t> client(path);
+            std::mt19937_64 rng(1);
+            for (int b = 0; b < 10; b++) {
+                for (int i = 0; i < 10000; i++)
+                    client.insert(rng() % 1000000);
+                client.execute();
+            }
+        }
+        queue_load(path, 1, 1, 1, 100000);
+        queue_load(path, 1, 1, 16, 200000);
+        queue_load(path, 1, 256, 4, 2000000);
+        queue_load(path, 4, 256, 4, 2000000);
+        queue_load(path, 4, 4096, 2, 2000000);
+        server.stop();
+        loop.join();
+    }
+
+    // graph for layer search: neighbors of a point are its neighbors in
+    // orders of points by a few random projections
+    struct NnGraph {
+        size_t dim;
+        std::vector<float> points;
+        std::vector<std::vector<uint32_t>> adj;
+
+        float dist(const float *q, uint32_t v) const {
+            const float *p = &points[v * dim];
+            float d = 0;
+            for (size_t i = 0; i < dim; i++)
+                d += (q[i] - p[i]) * (q[i] - p[i]);
+            return d;
+        }
+    };
+    NnGraph nn_graph(size_t n, size_t dim, std::mt19937_64 &rng) {
+        NnGraph g{dim, std::vector<float>(n * dim), std::vector<std::vector<uint32_t>>(n)};
+        std::normal_distribution<float> norm;
+        for (auto &x : g.points)
+            x = norm(rng);
+        std::vector<uint32_t> order(n);
+        std::vector<float> proj(n), dir(dim);
+        for (int p = 0; p < 4; p++) {
+            for (auto &x : dir)
+                x = norm(rng);
+            for (size_t v = 0; v < n; v++) {
+                proj[v] = 0;
+                for (size_t i = 0; i < dim; i++)
+                    proj[v] += dir[i] * g.points[v * dim + i];
+                order[v] = uint32_t(v);
+            }
+            std::sort(order.begin(), order.end(),
+                      [&](uint32_t a, uint32_t b) { return proj[a] < proj[b]; });
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = i >= 4 ? i - 4 : 0; j < std::min(n, i + 5); j++) {
+                    if (j != i)
+                        g.adj[order[i]].push_back(order[j]);
+                }
+            }
+        }
+        return g;
+    }
+
+    using NnItem = alg::SearchQueues<float, uint32_t, 512>::Item;
+    struct FarFirst {
+        NnItem it;
+        bool operator < (const FarFirst &r) const {
+            return r.it < it;
+        }
+    };
+    // same search as search_layer on a pair of Bheaps
+    void bheap_search(const NnGraph &g, const float *q, size_t ef, alg::VisitedSet &visited,
+                      std::vector<NnItem> &out) {
+        alg::Bheap<NnItem> cand;
+        alg::Bheap<FarFirst> best;
+        visited.reset();
+        visited.visit(0);
+        NnItem e{g.dist(q, 0), 0};
+        cand.insert(e);
+        best.insert(FarFirst{e});
+        while (cand.size() > 0) {
+            NnItem c = cand.pop();
+            if (best.size() >= ef && best.get_min().it < c)
+                break;
+            for (uint32_t v : g.adj[c.id]) {
+                if (!visited.visit(v))
+                    continue;
+                NnItem it{g.dist(q, v), v};
+                if (best.size() >= ef) {
+                    if (!(it < best.get_min().it))
+                        continue;
+                    best.pop();
+                }
+                best.insert(FarFirst{it});
+                cand.insert(it);
+            }
+        }
+        out.clear();
+        while (best.size() > 0)
+            out.push_back(best.pop().it);
+        std::reverse(out.begin(), out.end());
+    }
+
+    void bench_nn_search() {
+        const size_t n = 100000, dim = 16, queries = 2000;
+        std::mt19937_64 rng(1);
+        NnGraph g = nn_graph(n, dim, rng);
+        std::vector<float> qs(queries * dim);
+        std::normal_distribution<float> norm;
+        for (auto &x : qs)
+            x = norm(rng);
+        alg::VisitedSet visited(n);
+        for (size_t ef : {size_t(16), size_t(64), size_t(256)}) {
+            std::vector<std::vector<NnItem>> res(queries), ref(queries);
+            size_t evals = 0;
+            alg::SearchQueues<float, uint32_t, 512> sq;
+            auto start = Clock::now();
+            for (size_t i = 0; i < queries; i++) {
+                const float *q = &qs[i * dim];
+                alg::search_layer(sq, visited, uint32_t(0), ef,
+                                  [&](uint32_t v) -> const std::vector<uint32_t> & { return g.adj[v]; },
+                                  [&](uint32_t v) { evals++; return g.dist(q, v); });
+                sq.results(res[i]);
+            }
+            double sec = seconds_since(start);
+            char name[96];
+            std::snprintf(name, sizeof(name), "layer search ef=%zu SearchQueues", ef);
+            report(name, queries, sec);
+            start = Clock::now();
+            for (size_t i = 0; i < queries; i++)
+                bheap_search(g, &qs[i * dim], ef, visited, ref[i]);
+            sec = seconds_since(start);
+            size_t same = 0;
+            for (size_t i = 0; i < queries; i++)
+                same += res[i].size() == ref[i].size()
+                        && std::equal(res[i].begin(), res[i].end(), ref[i].begin(),
+                                      [](const NnItem &a, const NnItem &b) { return a.id == b.id; });
+            std::snprintf(name, sizeof(name), "layer search ef=%zu Bheap pair", ef);
+            report(name, queries, sec);
+            std::printf("%-44s %.0f distances per query, same results in %zu/%zu queries\n", "",
+                        double(evals) / double(queries), same, queries);
+        }
+    }
+
+    // binary order feed: 22-byte records type, side, qty, id, price
+    enum FeedType : uint8_t { FEED_ADD, FEED_CANCEL, FEED_REPLACE };
+    const size_t FEED_RECORD = 22;
+
+    void write_feed(const std::string &path, size_t n) {
+        std::mt19937_64 rng(1);
+        std::vector<uint64_t> live;
+        uint64_t next_id = 1;
+        int64_t mid = 100000;
+        std::vector<char> rec(FEED_RECORD);
+        FILE *f = std::fopen(path.c_str(), "wb");
+        for (size_t i = 0; i < n; i++) {
+            uint64_t c = rng() % 100;
+            uint8_t type = live.empty() || c < 45 ? FEED_ADD : c < 85 ? FEED_CANCEL : FEED_REPLACE;
+            uint8_t side = uint8_t(rng() % 2);
+            uint32_t qty = uint32_t(rng() % 100 + 1);
+            uint64_t id;
+            if (rng() % 64 == 0)
+                mid += int64_t(rng() % 5) - 2;
+            // mostly passive, 1 in 20 crosses the spread
+            int64_t off = rng() % 20 == 0 ? -2 : int64_t(rng() % 50) + 1;
+            int64_t price = side == alg::OrderBook<>::BID ? mid - off : mid + off;
+            if (type == FEED_ADD) {
+                id = next_id++;
+                live.push_back(id);
+            } else {
+                size_t k = rng() % live.size();
+                id = live[k];
+                if (type == FEED_CANCEL) {
+                    live[k] = live.back();
+                    live.pop_back();
+                }
+            }
+            rec[0] = char(type);
+            rec[1] = char(side);
+            std::memcpy(&rec[2], &qty, 4);
+            std::memcpy(&rec[6], &id, 8);
+            std::memcpy(&rec[14], &price, 8);
+            std::fwrite(rec.data(), 1, rec.size(), f);
+        }
+        std::fclose(f);
+    }
+
+    // replays the feed read back from disk, timing every message
+    void bench_order_book() {
+        const size_t n = 4000000;
+        std::string path = "/tmp/alg_bench_feed_" + std::to_string(getpid()) + ".bin";
+        write_feed(path, n);
+        std::vector<char> feed(n * FEED_RECORD);
+        FILE *f = std::fopen(path.c_str(), "rb");
+        size_t got = std::fread(feed.data(), 1, feed.size(), f);
+        std::fclose(f);
+        std::remove(path.c_str());
+        if (got != feed.size()) {
+            std::printf("order book feed: short read\n");
+            return;
+        }
+
+        using Book = alg::OrderBook<>;
+        Book book;
+        std::vector<float> lat[3];
+        size_t fills = 0;
+        auto on_fill = [&](uint64_t, uint64_t, int64_t, uint64_t) { fills++; };
+        auto start = Clock::now();
+        for (size_t i = 0; i < n; i++) {
+            const char *r = &feed[i * FEED_RECORD];
+            uint32_t qty;
+            uint64_t id;
+            int64_t price;
+            std::memcpy(&qty, r + 2, 4);
+            std::memcpy(&id, r + 6, 8);
+            std::memcpy(&price, r + 14, 8);
+            auto t = Clock::now();
+            if (r[0] == FEED_ADD)
+                book.limit(id, Book::Side(r[1]), price, qty, on_fill);
+            else if (r[0] == FEED_CANCEL)
+                book.cancel(id);
+            else
+                book.replace(id, price, qty, on_fill);
+            lat[size_t(r[0])].push_back(float(std::chrono::duration<double>(Clock::now() - t).count()));
+        }
+        double sec = seconds_since(start);
+        report("order book feed replay", n, sec);
+        const char *names[] = {"add", "cancel", "replace"};
+        for (size_t k = 0; k < 3; k++) {
+            std::vector<float> &l = lat[k];
+            std::sort(l.begin(), l.end());
+            std::printf("%-44s %-7s p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns\n", "", names[k],
+                        1e9 * l[l.size() / 2], 1e9 * l[l.size() * 99 / 100],
+                        1e9 * l[l.size() * 999 / 1000]);
+        }
+        std::printf("%-44s %zu fills, %zu resting orders, %zu+%zu levels\n", "", fills, book.size(),
+                    book.levels(Book::BID), book.levels(Book::ASK));
+    }
+
+    // key ranks drawn from Zipf(s) over n keys, rank 0 the most popular
+    std::vector<uint32_t> zipf_keys(size_t n, double s, size_t count, std::mt19937_64 &rng) {
+        std::vector<double> cdf(n);
+        double sum = 0;
+        for (size_t i = 0; i < n; i++)
+            cdf[i] = sum += 1 / std::pow(double(i + 1), s);
+        std::uniform_real_distribution<double> u(0, sum);
+        std::vector<uint32_t> keys(count);
+        for (auto &k : keys)
+            k = uint32_t(std::lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin());
+        // scatter ranks over the key space so popular keys don't hash together
+        for (auto &k : keys)
+            k = uint32_t((uint64_t(k) * 2654435761u) % n);
+        return keys;
+    }
+
+    // LRU baseline: O(1) hit, list splice instead of a heap update
+    struct LruCache {
+        size_t capacity, used = 0;
+        std::list<std::pair<uint32_t, uint64_t>> order;  // key, size; front is newest
+        std::unordered_map<uint32_t, decltype(order)::iterator> index;
+        explicit LruCache(size_t c) : capacity(c) {}
+        uint64_t *get(uint32_t k) {
+            auto it = index.find(k);
+            if (it == index.end())
+                return nullptr;
+            order.splice(order.begin(), order, it->second);
+            return &it->second->second;
+        }
+        void put(uint32_t k, uint64_t, size_t size, double) {
+            while (used + size > capacity) {
+                used -= order.back().second;
+                index.erase(order.back().first);
+                order.pop_back();
+            }
+            order.emplace_front(k, size);
+            index.emplace(k, order.begin());
+            used += size;
+        }
+    };
+
+    // get, put on miss; entry size 1..16 and cost 1..4 fixed per key
+    template <typename Cache>
+    void cache_run(const char *policy, const std::vector<uint32_t> &keys, size_t capacity) {
+        Cache cache(capacity);
+        std::vector<float> hit_lat;
+        hit_lat.reserve(keys.size());
+        size_t hits = 0;
+        auto start = Clock::now();
+        for (uint32_t k : keys) {
+            auto t = Clock::now();
+            if (cache.get(k)) {
+                hit_lat.push_back(float(std::chrono::duration<double>(Clock::now() - t).count()));
+                hits++;
+            } else {
+                cache.put(k, k, k % 16 + 1, double(k % 4 + 1));
+            }
+        }
+        double sec = seconds_since(start);
+        std::sort(hit_lat.begin(), hit_lat.end());
+        char name[96];
+        std::snprintf(name, sizeof(name), "zipf cache %zu %s", capacity, policy);
+        report(name, keys.size(), sec);
+        std::printf("%-44s hit ratio %.3f, hit p50 %.0f ns, p99 %.0f ns\n", "",
+                    double(hits) / double(keys.size()), 1e9 * hit_lat[hit_lat.size() / 2],
+                    1e9 * hit_lat[hit_lat.size() * 99 / 100]);
+    }
+
+    // 1M keys, Zipf s=0.99, cache holds about 1% and 10% of the key space
+    void bench_cost_cache() {
+        std::mt19937_64 rng(1);
+        const size_t n = 1000000;
+        std::vector<uint32_t> keys = zipf_keys(n, 0.99, 4000000, rng);
+        for (size_t capacity : {size_t(85000), size_t(850000)}) {
+            cache_run<alg::CostCache<uint32_t, uint64_t, alg::GreedyDualSize>>(
+                "GreedyDualSize", keys, capacity);
+            cache_run<alg::CostCache<uint32_t, uint64_t, alg::LfuAging>>(
+                "LfuAging", keys, capacity);
+            cache_run<alg::CostCache<uint32_t, uint64_t, alg::GreedyDualSizeFreq>>(
+                "GreedyDualSizeFreq", keys, capacity);
+            cache_run<LruCache>("LRU list", keys, capacity);
+        }
+    }
+
+    // connection balancer: acquire a server for each new connection, release
+    // the oldest one, about 4 connections per server stay open
+    void bench_least_loaded() {
+        const size_t ops = 4000000;
+        for (size_t n : {size_t(64), size_t(1000), size_t(100000)}) {
+            char name[96];
+            {
+                alg::LoadBuckets lb;
+                for (size_t i = 0; i < n; i++)
+                    lb.insert();
+                std::deque<uint32_t> open;
+                auto start = Clock::now();
+                for (size_t i = 0; i < ops; i++) {
+                    open.push_back(lb.acquire());
+                    if (open.size() > 4 * n) {
+                        lb.release(open.front());
+                        open.pop_front();
+                    }
+                }
+                std::snprintf(name, sizeof(name), "least loaded n=%zu LoadBuckets", n);
+                report(name, ops, seconds_since(start));
+            }
+            {
+                // key load << 32 | id, decrease_key for release, pop + insert
+                // for acquire
+                alg::FibHeap<uint64_t> heap;
+                std::vector<std::shared_ptr<alg::FibHeapNode<uint64_t>>> node(n);
+                for (size_t i = 0; i < n; i++)
+                    node[i] = heap.insert(i);
+                std::deque<uint32_t> open;
+                auto start = Clock::now();
+                for (size_t i = 0; i < ops; i++) {
+                    uint64_t k = heap.pop();
+                    uint32_t id = uint32_t(k);
+                    node[id] = heap.insert(k + (uint64_t(1) << 32));
+                    open.push_back(id);
+                    if (open.size() > 4 * n) {
+                        uint32_t r = open.front();
+                        open.pop_front();
+                        heap.decrease_key(node[r], node[r]->get_key() - (uint64_t(1) << 32));
+                    }
+                }
+                std::snprintf(name, sizeof(name), "least loaded n=%zu FibHeap", n);
+                report(name, ops, seconds_since(start));
+            }
+        }
+    }
+
+    // per-block code build as a block compressor does it: histogram of a
+    // 64 KB block, code lengths, canonical codes
+    void bench_huffman() {
+        const size_t blocks = 2000;
+        std::mt19937_64 rng(1);
+        alg::HuffmanBuilder hb;
+        for (size_t symbols : {size_t(256), size_t(286), size_t(4096)}) {
+            // skew changes per block, as it does across a file
+            std::vector<std::vector<uint64_t>> freq(blocks, std::vector<uint64_t>(symbols));
+            for (auto &f : freq) {
+                std::geometric_distribution<size_t> g(0.002 + double(rng() % 100) / 1000);
+                for (size_t i = 0; i < 65536; i++)
+                    f[std::min(g(rng), symbols - 1)]++;
+            }
+            std::vector<uint8_t> len(symbols);
+            std::vector<uint64_t> codes(symbols);
+            for (unsigned max_len : {0u, 15u, 11u}) {
+                if ((size_t(1) << max_len) < symbols && max_len != 0)
+                    continue;
+                uint64_t bits = 0;
+                auto start = Clock::now();
+                for (auto &f : freq) {
+                    hb.lengths(f.data(), symbols, len.data(), max_len);
+                    alg::HuffmanBuilder::canonical(len.data(), symbols, codes.data());
+                    for (size_t i = 0; i < symbols; i++)
+                        bits += f[i] * len[i];
+                }
+                double sec = seconds_since(start);
+                char name[96];
+                std::snprintf(name, sizeof(name), "huffman block %zu symbols max_len %u", symbols, max_len);
+                report(name, blocks, sec);
+                std::printf("%-44s %.3f bits/symbol\n", "", double(bits) / double(blocks * 65536));
+            }
+        }
+    }
+
+    // McIlroy's adversary, values are frozen when compared so that the
+    // pivot candidate is small; gives a median-of-3 quickselect killer
+    std::vector<int> select_killer(int n) {
+        std::vector<int> val(size_t(n), n);
+        std::vector<int> ids(val.size());
+        int nsolid = 0, candidate = 0;
+        for (int i = 0; i < n; i++)
+            ids[size_t(i)] = i;
+        alg::soft_select(ids.begin(), ids.begin() + n / 2, ids.end(), [&](int x, int y) {
+            if (val[size_t(x)] == n && val[size_t(y)] == n)
+                val[size_t(x == candidate ? x : y)] = nsolid++;
+            if (val[size_t(x)] == n)
+                candidate = x;
+            else if (val[size_t(y)] == n)
+                candidate = y;
+            return val[size_t(x)] < val[size_t(y)];
+        });
+        return val;
+    }
+
+    void bench_soft_heap() {
+        const size_t n = 1000000;
+        std::mt19937_64 rng(1);
+        {
+            std::vector<uint64_t> keys(n);
+            for (auto &k : keys)
+                k = rng();
+            alg::SoftHeap<uint64_t> soft(0.1);
+            auto start = Clock::now();
+            for (uint64_t k : keys)
+                soft.insert(k);
+            report("insert 1M SoftHeap eps=0.1", n, seconds_since(start));
+            alg::Bheap<uint64_t> bheap;
+            start = Clock::now();
+            for (uint64_t k : keys)
+                bheap.insert(k);
+            report("insert 1M Bheap", n, seconds_since(start));
+            start = Clock::now();
+            for (size_t i = 0; i < n; i++)
+                soft.pop();
+            report("pop 1M SoftHeap eps=0.1", n, seconds_since(start));
+            start = Clock::now();
+            for (size_t i = 0; i < n; i++)
+                bheap.pop();
+            report("pop 1M Bheap", n, seconds_since(start));
+        }
+        std::vector<int> random(n), sorted(n);
+        for (size_t i = 0; i < n; i++) {
+            random[i] = int(rng() % n);
+            sorted[i] = int(i);
+        }
+        struct Input {
+            const char *name;
+            std::vector<int> data;
+        };
+        Input inputs[] = {{"random", random}, {"sorted", sorted},
+                          {"median-of-3 killer", select_killer(int(n / 10))}};
+        for (Input &in : inputs) {
+            size_t m = in.data.size();
+            std::vector<int> a = in.data;
+            auto start = Clock::now();
+            alg::soft_select(a.begin(), a.begin() + long(m / 2), a.end());
+            double sec = seconds_since(start);
+            char name[96];
+            std::snprintf(name, sizeof(name), "select %zu %s soft_select", m, in.name);
+            report(name, m, sec);
+            std::vector<int> b = in.data;
+            start = Clock::now();
+            std::nth_element(b.begin(), b.begin() + long(m / 2), b.end());
+            sec = seconds_since(start);
+            std::snprintf(name, sizeof(name), "select %zu %s nth_element", m, in.name);
+            report(name, m, sec);
+            if (a[m / 2] != b[m / 2])
+                std::printf("%-44s WRONG median\n", "");
+        }
+    }
+
+    // 32M float keys (128 MB), GB/s of keys scanned; xor of the array's
+    // 64-bit words with 4 accumulators is the read bandwidth to compare with
+    void bench_topk() {
+        const size_t n = size_t(32) << 20;
+        std::vector<float> keys(n);
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> u(0, 1);
+        for (auto &k : keys)
+            k = u(rng);
+        char name[96];
+        auto gbps = [&](double sec) {
+            std::printf("%-44s %.2f GB/s\n", "", double(n * sizeof(float)) / sec / 1e9);
+        };
+        auto start = Clock::now();
+        uint64_t acc[4] = {};
+        for (size_t i = 0; i < n; i += 8) {
+            for (size_t j = 0; j < 4; j++) {
+                uint64_t w;
+                std::memcpy(&w, &keys[i + 2 * j], 8);
+                acc[j] ^= w;
+            }
+        }
+        double sec = seconds_since(start);
+        std::snprintf(name, sizeof(name), "read 32M floats (xor %llx)",
+                      (unsigned long long)(acc[0] ^ acc[1] ^ acc[2] ^ acc[3]) & 0xff);
+        report(name, n, sec);
+        gbps(sec);
+        for (size_t k : {size_t(10), size_t(1000)}) {
+            alg::TopK<float> one(k), batch(k);
+            start = Clock::now();
+            for (float x : keys)
+                one.push(x);
+            sec = seconds_since(start);
+            std::snprintf(name, sizeof(name), "top %zu of 32M floats, push", k);
+            report(name, n, sec);
+            gbps(sec);
+            start = Clock::now();
+            batch.push_batch(keys.data(), n);
+            sec = seconds_since(start);
+            std::snprintf(name, sizeof(name), "top %zu of 32M floats, push_batch%s", k,
+                          one.sorted() == batch.sorted() ? "" : " WRONG");
+            report(name, n, sec);
+            gbps(sec);
+        }
+    }
+
+    struct Bench {
+        const char *name;
+        void (*run)();
+    };
+    const Bench benches[] = {
+        {"calendar", bench_calendar},
+        {"simulator", bench_simulator},
+        {"kway", bench_kway},
+        {"extsort", bench_extsort},
+        {"queue_server", bench_queue_server},
+        {"nn_search", bench_nn_search},
+        {"order_book", bench_order_book},
+        {"cost_cache", bench_cost_cache},
+        {"least_loaded", bench_least_loaded},
+        {"huffman", bench_huffman},
+        {"soft_heap", bench_soft_heap},
+        {"topk", bench_topk},
+    };
+}
+
+int main(int argc, char **argv) {
+    for (const Bench &b : benches) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+            selected |= std::strcmp(argv[i], b.name) == 0;
+        if (selected)
+            b.run();
+    }
+    return 0;
+}
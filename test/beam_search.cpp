@@ -0,0 +1,116 @@
+// BeamSearch: step() equals sorting all rows * vocab candidates and taking
+// the best width, with many equal scores, for 1-4 threads and the same
+// result for every thread count; steps after the first don't allocate
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+#include "BeamSearch.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t n) {
+    allocations++;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+// the pair above and below is matched, GCC only sees free after new
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+using Beam = alg::BeamSearch<float>;
+
+static std::vector<Beam::Candidate> brute(const std::vector<float> &beam, const std::vector<float> &s,
+                                          size_t rows, size_t vocab, size_t width) {
+    std::vector<Beam::Candidate> all;
+    for (size_t b = 0; b < rows; b++) {
+        for (size_t v = 0; v < vocab; v++)
+            all.push_back(Beam::Candidate{beam[b] + s[b * vocab + v], uint32_t(b), uint32_t(v)});
+    }
+    std::sort(all.begin(), all.end(), [](const Beam::Candidate &a, const Beam::Candidate &b) { return b < a; });
+    all.resize(std::min(all.size(), width));
+    return all;
+}
+
+static bool same(const std::vector<Beam::Candidate> &a, const std::vector<Beam::Candidate> &b) {
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].score != b[i].score || a[i].beam != b[i].beam || a[i].token != b[i].token)
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    struct Shape {
+        size_t rows, vocab, width;
+    };
+    const Shape shapes[] = {
+        {1, 1, 1}, {1, 10, 20}, {3, 7, 5}, {4, 1000, 8},
+        {8, 5003, 16}, {16, 3000, 64}, {5, 40000, 1}, {64, 700, 200},
+    };
+    for (const Shape &sh : shapes) {
+        std::vector<std::unique_ptr<Beam>> by_threads;
+        for (unsigned t = 1; t <= 4; t++)
+            by_threads.emplace_back(new Beam(sh.width, t));
+        for (int round = 0; round < 4; round++) {
+            std::vector<float> beam(sh.rows), s(sh.rows * sh.vocab);
+            // few distinct values, ties everywhere including across thread parts
+            unsigned distinct = round % 2 ? 4 : 1000;
+            for (auto &x : beam)
+                x = float(rng() % 3);
+            for (auto &x : s)
+                x = -float(rng() % distinct) / 4;
+            auto want = brute(beam, s, sh.rows, sh.vocab, sh.width);
+            for (auto &bs : by_threads) {
+                const auto &got = bs->step(beam.data(), s.data(), sh.rows, sh.vocab);
+                CHECK(same(got, want));
+            }
+        }
+    }
+
+    {
+        // later steps of the same width reuse every buffer
+        const size_t rows = 8, vocab = 8192, width = 32;
+        std::vector<float> beam(rows), s(rows * vocab);
+        Beam bs(width, 3);
+        for (int round = 0; round < 5; round++) {
+            for (auto &x : beam)
+                x = float(rng() % 10);
+            for (auto &x : s)
+                x = float(rng() % 100000) / 1000;
+            size_t before = allocations.load();
+            const auto &got = bs.step(beam.data(), s.data(), rows, vocab);
+            CHECK(round == 0 || allocations.load() == before);
+            CHECK(got.size() == width);
+        }
+        bs.set_threads(2);
+        auto want = brute(beam, s, rows, vocab, width);
+        CHECK(same(bs.step(beam.data(), s.data(), rows, vocab), want));
+        CHECK(bs.step(beam.data(), s.data(), 0, vocab).empty());
+    }
+    bool thrown = false;
+    try {
+        Beam bad(0);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    std::printf("beam_search ok\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+// BranchAndBound: 0/1 knapsack optimum matches dynamic programming with an
+// unbounded open list, with a budget small enough to force trimming and
+// regeneration of forgotten children, and with parallel workers sharing
+// the incumbent; FibHeap and Bheap open lists; nodes without a default
+// constructor; exceptions from expand reach solve
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "BranchAndBound.hpp"
+#include "Bheap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+// FibHeap and Bheap nodes are released through shared_ptr cycles
+extern "C" const char *__asan_default_options() { return "detect_leaks=0"; }
+
+struct Knapsack {
+    struct Node {
+        Node(uint32_t level, int weight, int value, uint32_t taken)
+            : level(level), weight(weight), value(value), taken(taken) {
+        }
+        uint32_t level;
+        int weight;
+        int value;
+        uint32_t taken;
+    };
+    std::vector<int> w, v;  // sorted by value density
+    int capacity;
+    mutable std::atomic<long> expands{0};
+    long fail_at = -1;
+
+    // minus value of the fractional relaxation
+    double bound(const Node &n) const {
+        double val = n.value;
+        int room = capacity - n.weight;
+        for (size_t i = n.level; i < w.size() && room > 0; i++) {
+            if (w[i] <= room) {
+                room -= w[i];
+                val += v[i];
+            } else {
+                val += double(v[i]) * room / w[i];
+                room = 0;
+            }
+        }
+        return -val;
+    }
+    bool is_solution(const Node &n) const {
+        return n.level == w.size();
+    }
+    void expand(const Node &n, std::vector<Node> &children) const {
+        if (expands++ == fail_at)
+            throw std::runtime_error("expand failed");
+        uint32_t i = n.level;
+        if (n.weight + w[i] <= capacity)
+            children.emplace_back(i + 1, n.weight + w[i], n.value + v[i], n.taken | 1u << i);
+        children.emplace_back(i + 1, n.weight, n.value, n.taken);
+    }
+};
+
+static int best_value(const Knapsack &k) {
+    std::vector<int> dp(size_t(k.capacity) + 1, 0);
+    for (size_t i = 0; i < k.w.size(); i++) {
+        for (int c = k.capacity; c >= k.w[i]; c--)
+            dp[size_t(c)] = std::max(dp[size_t(c)], dp[size_t(c - k.w[i])] + k.v[i]);
+    }
+    return dp[size_t(k.capacity)];
+}
+
+template <template <typename> class Heap>
+static void solve(const Knapsack &k, size_t memory, unsigned threads, int want, bool trims) {
+    alg::BranchAndBound<Knapsack, Heap> bb(k, memory, threads);
+    auto r = bb.solve(Knapsack::Node(0, 0, 0, 0));
+    CHECK(r.found && r.best);
+    CHECK(r.cost == -want);
+    CHECK(r.best->value == want && r.best->weight <= k.capacity);
+    int w = 0, v = 0;
+    for (size_t i = 0; i < k.w.size(); i++) {
+        if (r.best->taken >> i & 1) {
+            w += k.w[i];
+            v += k.v[i];
+        }
+    }
+    CHECK(w == r.best->weight && v == want);
+    CHECK(trims == (r.dropped > 0));
+    // nothing strictly better than the optimum
+    auto none = bb.solve(Knapsack::Node(0, 0, 0, 0), -want);
+    CHECK(!none.found && !none.best);
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    for (int round = 0; round < 6; round++) {
+        Knapsack k;
+        size_t n = 20 + rng() % 8;
+        std::vector<std::pair<int, int>> items;
+        int total = 0;
+        for (size_t i = 0; i < n; i++) {
+            int w = 10 + int(rng() % 90);
+            items.emplace_back(w, w + 10 + int(rng() % 5));  // correlated, hard to bound
+            total += w;
+        }
+        std::sort(items.begin(), items.end(), [](auto &a, auto &b) {
+            return double(a.second) / a.first > double(b.second) / b.first;
+        });
+        for (auto &it : items) {
+            k.w.push_back(it.first);
+            k.v.push_back(it.second);
+        }
+        k.capacity = total / 2;
+        int want = best_value(k);
+
+        solve<alg::FibHeap>(k, size_t(1) << 30, 1, want, false);
+        solve<alg::Bheap>(k, size_t(1) << 30, 1, want, false);
+        alg::BranchAndBound<Knapsack> small(k, 1);
+        CHECK(small.open_limit() == 4);
+        solve<alg::FibHeap>(k, 1, 1, want, true);
+        solve<alg::Bheap>(k, 1, 1, want, true);
+        solve<alg::FibHeap>(k, 1, 4, want, true);
+        solve<alg::FibHeap>(k, size_t(1) << 30, 4, want, false);
+    }
+    {
+        Knapsack k;
+        k.w = {3, 4, 5};
+        k.v = {4, 5, 6};
+        k.capacity = 7;
+        k.fail_at = 2;
+        alg::BranchAndBound<Knapsack> bb(k, size_t(1) << 20, 2);
+        bool thrown = false;
+        try {
+            bb.solve(Knapsack::Node(0, 0, 0, 0));
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    std::printf("branch_and_bound ok\n");
+    return 0;
+}
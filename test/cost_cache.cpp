@@ -0,0 +1,199 @@
+// CostCache: GreedyDual eviction order and inflation, hits raising
+// priority, capacity accounting across overwrites and oversize puts, a
+// random run against a linear-scan model, values released on eviction
+// and values without a default constructor
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include "CostCache.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+// GreedyDual over a map, victim found by scanning
+template <typename Policy>
+struct Model {
+    struct E {
+        int value;
+        size_t size;
+        double cost;
+        uint64_t freq;
+        double h;
+        uint64_t tick;
+    };
+    size_t capacity;
+    size_t used = 0;
+    double L = 0;
+    uint64_t tick = 0;
+    std::map<int, E> m;
+
+    void touch(E &e) {
+        e.h = L + Policy::credit(e.freq, e.cost, e.size);
+        e.tick = tick++;
+    }
+    int *get(int k) {
+        auto it = m.find(k);
+        if (it == m.end())
+            return nullptr;
+        it->second.freq++;
+        touch(it->second);
+        return &it->second.value;
+    }
+    void erase(int k) {
+        auto it = m.find(k);
+        if (it != m.end()) {
+            used -= it->second.size;
+            m.erase(it);
+        }
+    }
+    void put(int k, int v, size_t size, double cost) {
+        uint64_t freq = 1;
+        auto it = m.find(k);
+        if (it != m.end())
+            freq = it->second.freq + 1;
+        erase(k);
+        if (size > capacity)
+            return;
+        while (used + size > capacity) {
+            auto victim = m.begin();
+            for (auto j = m.begin(); j != m.end(); ++j) {
+                if (j->second.h < victim->second.h ||
+                    (j->second.h == victim->second.h && j->second.tick < victim->second.tick))
+                    victim = j;
+            }
+            L = victim->second.h;
+            erase(victim->first);
+        }
+        E &e = m[k];
+        e = E{v, size, cost, freq, 0, 0};
+        touch(e);
+        used += size;
+    }
+};
+
+template <typename Policy>
+static void random_run(size_t capacity, std::mt19937_64 &rng) {
+    alg::CostCache<int, int, Policy> c(capacity);
+    Model<Policy> ref{capacity};
+    for (int op = 0; op < 20000; op++) {
+        int k = int(rng() % 64);
+        uint64_t r = rng() % 10;
+        if (r < 5) {
+            int *a = c.get(k);
+            int *b = ref.get(k);
+            CHECK((a == nullptr) == (b == nullptr));
+            CHECK(a == nullptr || *a == *b);
+        } else if (r < 9) {
+            size_t size = rng() % 8 == 0 ? capacity + 1 : 1 + rng() % 4;
+            double cost = double(1 + rng() % 10);
+            c.put(k, op, size, cost);
+            ref.put(k, op, size, cost);
+        } else {
+            CHECK(c.erase(k) == (ref.m.count(k) != 0));
+            ref.erase(k);
+        }
+        CHECK(c.used() == ref.used);
+        CHECK(c.used() <= c.capacity());
+        CHECK(c.size() == ref.m.size());
+        CHECK(c.inflation() == ref.L);
+        CHECK(c.contains(k) == (ref.m.count(k) != 0));
+    }
+}
+
+struct Blob {
+    explicit Blob(const std::string &s) : s(s) {
+    }
+    std::string s;
+};
+
+int main() {
+    {
+        // H = L + cost / size, the smallest H goes first and sets L
+        alg::CostCache<int, int> c(3);
+        c.put(1, 10, 1, 1);
+        c.put(2, 20, 1, 3);
+        c.put(3, 30, 1, 2);
+        c.put(4, 40, 1, 1);     // evicts 1 (H 1)
+        CHECK(!c.contains(1) && c.inflation() == 1);
+        c.put(5, 50, 1, 5);     // 3 and 4 have H 2, 3 is older
+        CHECK(!c.contains(3) && c.contains(4) && c.inflation() == 2);
+        c.put(6, 60, 1, 1);     // 4 (H 2) before 2 (H 3) and 5 (H 7)
+        CHECK(!c.contains(4) && c.contains(2) && c.contains(5));
+        CHECK(c.size() == 3 && c.used() == 3);
+    }
+    {
+        // a hit moves an entry behind its equals
+        alg::CostCache<int, int> c(2);
+        c.put(1, 10);
+        c.put(2, 20);
+        CHECK(c.get(1) != nullptr && *c.get(1) == 10);
+        c.put(3, 30);
+        CHECK(c.contains(1) && !c.contains(2));
+        CHECK(c.get(2) == nullptr);
+    }
+    {
+        // LFU with aging: hits raise credit
+        alg::CostCache<int, int, alg::LfuAging> c(2);
+        c.put(1, 10);
+        c.put(2, 20);
+        c.get(1);
+        c.get(1);               // H(1) = 3, H(2) = 1
+        c.put(3, 30);           // evicts 2, L = 1, H(3) = 2
+        CHECK(!c.contains(2) && c.inflation() == 1);
+        c.put(4, 40);           // evicts 3
+        CHECK(c.contains(1) && !c.contains(3) && c.contains(4));
+    }
+    {
+        // capacity accounting
+        alg::CostCache<int, int> c(10);
+        c.put(1, 10, 4);
+        c.put(2, 20, 4);
+        CHECK(c.used() == 8);
+        c.put(1, 11, 2);        // overwrite with a smaller size
+        CHECK(c.used() == 6 && *c.get(1) == 11);
+        c.put(2, 21, 8);        // old size is returned before checking room
+        CHECK(c.used() == 10 && c.size() == 2);
+        c.put(3, 30, 11);       // larger than capacity, not cached
+        CHECK(!c.contains(3) && c.used() == 10);
+        c.put(2, 22, 11);       // oversize overwrite drops the old entry
+        CHECK(!c.contains(2) && c.used() == 2 && c.size() == 1);
+        c.put(4, 40, 10);       // evicts 1
+        CHECK(c.used() == 10 && c.size() == 1 && !c.contains(1));
+        CHECK(c.erase(4) && !c.erase(4) && c.used() == 0);
+        bool thrown = false;
+        try {
+            c.put(5, 50, 0);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    {
+        // evicted and erased values are released, not kept in free slots
+        auto v = std::make_shared<int>(1);
+        alg::CostCache<int, std::shared_ptr<int>> c(1);
+        c.put(1, v);
+        CHECK(v.use_count() == 2);
+        c.put(2, nullptr);
+        CHECK(v.use_count() == 1);
+        c.put(2, v);
+        CHECK(c.erase(2) && v.use_count() == 1);
+    }
+    {
+        alg::CostCache<int, Blob> c(2);
+        c.put(1, Blob("a"));
+        c.put(2, Blob("b"));
+        c.put(3, Blob("c"));
+        CHECK(c.get(1) == nullptr && c.get(3)->s == "c");
+    }
+    std::mt19937_64 rng(1);
+    random_run<alg::GreedyDualSize>(16, rng);
+    random_run<alg::LfuAging>(16, rng);
+    random_run<alg::GreedyDualSizeFreq>(16, rng);
+    random_run<alg::GreedyDualSizeFreq>(3, rng);
+    std::printf("cost_cache ok\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+// CowHeap: forks change independently of each other, also when every
+// fork lives on its own thread
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <functional>
+#include "CowHeap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+using Heap = alg::CowHeap<uint64_t, std::less<uint64_t>, 4>;
+using Ref = std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>>;
+
+static void step(Heap &h, Ref &r, std::mt19937_64 &rng) {
+    if (r.empty() || rng() % 3 != 0) {
+        uint64_t k = rng() % 100000;
+        h.insert(k);
+        r.push(k);
+    } else {
+        CHECK(h.get_min() == r.top());
+        CHECK(h.pop() == r.top());
+        r.pop();
+    }
+    CHECK(h.size() == r.size());
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+
+    // a tree of forks: every fork keeps its own contents
+    {
+        std::vector<Heap> heaps(1);
+        std::vector<Ref> refs(1);
+        for (int op = 0; op < 20000; op++) {
+            size_t i = rng() % heaps.size();
+            if (rng() % 200 == 0 && heaps.size() < 16) {
+                heaps.push_back(heaps[i].fork());
+                refs.push_back(refs[i]);
+            } else if (rng() % 300 == 0 && heaps.size() > 1) {
+                heaps.erase(heaps.begin() + i);
+                refs.erase(refs.begin() + i);
+            } else {
+                step(heaps[i], refs[i], rng);
+            }
+        }
+        for (size_t i = 0; i < heaps.size(); i++) {
+            while (!refs[i].empty()) {
+                CHECK(heaps[i].pop() == refs[i].top());
+                refs[i].pop();
+            }
+        }
+    }
+
+    // forks change and drop shared chunks on different threads
+    for (int round = 0; round < 20; round++) {
+        Heap base;
+        Ref base_ref;
+        for (int i = 0; i < 2000; i++)
+            step(base, base_ref, rng);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            Heap h = base.fork();
+            threads.emplace_back([h, base_ref, t, round]() mutable {
+                std::mt19937_64 r(round * 4 + t);
+                Ref ref = base_ref;
+                for (int i = 0; i < 3000; i++)
+                    step(h, ref, r);
+                while (!ref.empty()) {
+                    CHECK(h.pop() == ref.top());
+                    ref.pop();
+                }
+            });
+        }
+        for (int i = 0; i < 3000; i++)
+            step(base, base_ref, rng);
+        for (auto &t : threads)
+            t.join();
+    }
+
+    std::printf("cow_heap ok\n");
+    return 0;
+}
@@ -0,0 +1,158 @@
+// DurableQueue: recovery after reopen, a failed log write keeps its
+// records pending and leaves no torn record behind, a failed automatic
+// commit doesn't lose the popped job or the inserted id
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "DurableQueue.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+// DurableQueue keeps jobs in a FibHeap, whose nodes leak shared_ptr cycles
+extern "C" const char *__asan_default_options() {
+    return "detect_leaks=0";
+}
+
+using Queue = alg::DurableQueue<uint64_t>;
+static const size_t RECORD_SIZE = 4 + 1 + 8 + 8 + sizeof(uint64_t);
+
+static off_t file_size(const std::string &path) {
+    struct stat st;
+    CHECK(stat(path.c_str(), &st) == 0);
+    return st.st_size;
+}
+
+static void check_same(Queue &q, std::map<Queue::JobId, uint64_t> ref) {
+    CHECK(q.size() == ref.size());
+    while (q.size() > 0) {
+        auto job = q.pop();
+        auto it = ref.find(job.first);
+        CHECK(it != ref.end() && it->second == job.second);
+        ref.erase(it);
+    }
+}
+
+int main() {
+    char dir[] = "/tmp/durable_queue_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    std::string path = dir;
+    std::string log = path + "/wal.log";
+    std::mt19937_64 rng(1);
+    std::map<Queue::JobId, uint64_t> ref;
+
+    // random changes survive reopen, with and without checkpoints
+    for (int reopen = 0; reopen < 5; reopen++) {
+        Queue q(path, 64);
+        CHECK(q.size() == ref.size());
+        for (int op = 0; op < 2000; op++) {
+            uint64_t c = rng() % 10;
+            if (c < 6 || ref.empty()) {
+                uint64_t k = rng() % 100000 + 1000;
+                ref[q.insert(k)] = k;
+            } else if (c < 8) {
+                auto job = q.pop();
+                CHECK(ref.count(job.first) && ref[job.first] == job.second);
+                ref.erase(job.first);
+            } else {
+                auto it = std::next(ref.begin(), rng() % ref.size());
+                it->second -= rng() % 1000;
+                q.decrease_key(it->first, it->second);
+            }
+        }
+        if (reopen == 2)
+            q.checkpoint();
+    }
+
+    // log write fails halfway: commit throws, records stay pending and
+    // the partial bytes are cut off the log
+    signal(SIGXFSZ, SIG_IGN);
+    {
+        Queue q(path, 1 << 20);
+        q.commit();
+        off_t before = file_size(log);
+        for (int i = 0; i < 100; i++) {
+            uint64_t k = rng() % 100000;
+            ref[q.insert(k)] = k;
+        }
+        struct rlimit old, lim;
+        CHECK(getrlimit(RLIMIT_FSIZE, &old) == 0);
+        lim = old;
+        lim.rlim_cur = rlim_t(before) + 5 * RECORD_SIZE / 2;
+        CHECK(setrlimit(RLIMIT_FSIZE, &lim) == 0);
+        bool thrown = false;
+        try {
+            q.commit();
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(file_size(log) == before);
+        // queue still takes changes
+        for (int i = 0; i < 10; i++) {
+            uint64_t k = rng() % 100000;
+            ref[q.insert(k)] = k;
+        }
+        CHECK(setrlimit(RLIMIT_FSIZE, &old) == 0);
+        q.commit();
+        CHECK(file_size(log) == before + off_t(110 * RECORD_SIZE));
+    }
+    {
+        // check_same pops every job, the destructor commits that
+        Queue q(path);
+        check_same(q, ref);
+        ref.clear();
+        for (int i = 0; i < 200; i++) {
+            uint64_t k = rng() % 100000;
+            ref[q.insert(k)] = k;
+        }
+    }
+
+    // automatic group commit fails inside pop and insert: they still
+    // return the job and the id, nothing is lost or resurrected
+    {
+        Queue q(path, 8);
+        q.commit();
+        struct rlimit old, lim;
+        CHECK(getrlimit(RLIMIT_FSIZE, &old) == 0);
+        lim = old;
+        lim.rlim_cur = rlim_t(file_size(log));
+        CHECK(setrlimit(RLIMIT_FSIZE, &lim) == 0);
+        for (int i = 0; i < 40; i++) {
+            if (i % 2 == 0) {
+                auto job = q.pop();
+                CHECK(ref.count(job.first) && ref[job.first] == job.second);
+                ref.erase(job.first);
+            } else {
+                uint64_t k = rng() % 100000;
+                ref[q.insert(k)] = k;
+            }
+        }
+        bool thrown = false;
+        try {
+            q.commit();
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(setrlimit(RLIMIT_FSIZE, &old) == 0);
+        q.commit();
+    }
+    {
+        Queue q(path);
+        check_same(q, ref);
+    }
+
+    unlink(log.c_str());
+    unlink((path + "/snapshot.bin").c_str());
+    rmdir(dir);
+    std::printf("durable_queue ok\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+// ExternalPriorityQueue: pops match std::priority_queue under a budget
+// small enough for many levels of runs, buffers stay within the budget
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "ExternalPriorityQueue.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+static void run(size_t memory, size_t fan_in, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    alg::ExternalPriorityQueue<uint64_t> q(memory, "/tmp", fan_in);
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> ref;
+    // grow with a few pops, then shrink, then grow again
+    for (int phase = 0; phase < 3; phase++) {
+        for (int op = 0; op < 60000; op++) {
+            bool push = phase == 1 ? rng() % 4 == 0 : rng() % 4 != 0;
+            if (push || ref.empty()) {
+                uint64_t x = rng() % 1000000;
+                q.push(x);
+                ref.push(x);
+            } else {
+                CHECK(q.top() == ref.top());
+                CHECK(q.pop() == ref.top());
+                ref.pop();
+            }
+            CHECK(q.size() == ref.size());
+        }
+    }
+    while (!ref.empty()) {
+        CHECK(q.pop() == ref.top());
+        ref.pop();
+    }
+    CHECK(q.empty());
+    CHECK(q.peak_buffer_bytes() > 0 && q.peak_buffer_bytes() <= memory);
+}
+
+int main() {
+    run(4096, 2, 1);
+    run(4096, 4, 2);
+    run(16384, 8, 3);
+    bool thrown = false;
+    try {
+        alg::ExternalPriorityQueue<uint64_t> q(64, "/tmp", 32);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    std::printf("external_priority_queue ok\n");
+    return 0;
+}
@@ -0,0 +1,38 @@
+// ExternalSorter: small budgets force many runs and level merges while pushing
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "ExternalSort.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+template <template <typename> class Heap>
+void sort_random(size_t n, size_t memory, size_t fan_in) {
+    std::mt19937 rng(static_cast<unsigned>(n));
+    std::vector<uint32_t> in(n);
+    for (auto &x : in)
+        x = rng() % 100000;
+    alg::ExternalSorter<uint32_t, std::less<uint32_t>, Heap> sorter(memory, "/tmp", fan_in);
+    sorter.push(in.begin(), in.end());
+    std::vector<uint32_t> out;
+    sorter.finish([&](const uint32_t *d, size_t cnt) { out.insert(out.end(), d, d + cnt); });
+    std::sort(in.begin(), in.end());
+    CHECK(out == in);
+    // sorter is reusable after finish
+    sorter.push(in.rbegin(), in.rend());
+    out.clear();
+    sorter.finish([&](const uint32_t *d, size_t cnt) { out.insert(out.end(), d, d + cnt); });
+    CHECK(out == in);
+}
+
+int main() {
+    sort_random<alg::external::VectorHeap>(0, 1 << 16, 4);
+    sort_random<alg::external::VectorHeap>(1000, 1 << 16, 4);
+    sort_random<alg::external::VectorHeap>(300000, 1 << 16, 4);
+    sort_random<alg::external::VectorHeap>(300000, 1 << 20, 128);
+    sort_random<alg::Bheap>(100000, 1 << 18, 3);
+    std::printf("external_sort ok\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Heap snapshots: save/load round trip, corrupt counts are rejected
+// before anything of their size is allocated, Bheap rejects snapshots
+// that aren't binomial heaps
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <stdexcept>
+#include <string>
+#include "Bheap.hpp"
+#include "FibHeap.h"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+// FibHeap and Bheap nodes link each other by shared_ptr and leak cycles
+extern "C" const char *__asan_default_options() {
+    return "detect_leaks=0";
+}
+
+// stream that can't seek, like a pipe
+struct PipeBuf : std::streambuf {
+    std::string data;
+    explicit PipeBuf(std::string d) : data(std::move(d)) {
+        setg(&data[0], &data[0], &data[0] + data.size());
+    }
+};
+
+template <typename Heap>
+static bool load_throws(const std::string &bytes, bool seekable) {
+    Heap heap;
+    try {
+        if (seekable) {
+            std::istringstream in(bytes);
+            heap.load(in);
+        } else {
+            PipeBuf buf(bytes);
+            std::istream in(&buf);
+            heap.load(in);
+        }
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+template <typename Heap>
+static void run(const char *name) {
+    std::mt19937_64 rng(1);
+    Heap heap;
+    std::vector<uint64_t> keys;
+    for (int i = 0; i < 10000; i++) {
+        keys.push_back(rng() % 1000000);
+        heap.insert(keys.back());
+        if (i % 7 == 0)
+            heap.pop();
+    }
+    std::ostringstream out;
+    const Heap &saved = heap;
+    saved.save(out);
+    std::string bytes = out.str();
+
+    for (bool seekable : {true, false}) {
+        Heap copy;
+        if (seekable) {
+            std::istringstream in(bytes);
+            copy.load(in);
+        } else {
+            PipeBuf buf(bytes);
+            std::istream in(&buf);
+            copy.load(in);
+        }
+        CHECK(copy.size() == heap.size());
+        Heap ref;
+        std::istringstream in(bytes);
+        ref.load(in);
+        while (ref.size() > 0)
+            CHECK(copy.pop() == ref.pop());
+    }
+
+    // count far beyond the data: 2^60 nodes would be exabytes of vectors
+    std::string huge = bytes;
+    uint64_t count = uint64_t(1) << 60;
+    std::memcpy(&huge[8], &count, sizeof(count));
+    CHECK(load_throws<Heap>(huge, true));
+    CHECK(load_throws<Heap>(huge, false));
+    // count one more than stored, truncated stream
+    std::memcpy(&count, &bytes[8], sizeof(count));
+    count++;
+    std::memcpy(&huge[8], &count, sizeof(count));
+    CHECK(load_throws<Heap>(huge, true));
+    CHECK(load_throws<Heap>(huge, false));
+    CHECK(load_throws<Heap>(bytes.substr(0, bytes.size() - 1), true));
+    std::printf("heap_snapshot %s ok\n", name);
+}
+
+// Bheap snapshot with the header of a real one
+static std::string bheap_bytes(const std::vector<uint32_t> &degrees,
+                               const std::vector<uint64_t> &keys) {
+    alg::Bheap<uint64_t> h;
+    std::ostringstream out;
+    h.save(out);
+    std::string b = out.str();
+    uint64_t n = keys.size();
+    std::memcpy(&b[8], &n, sizeof(n));
+    b.append(reinterpret_cast<const char *>(degrees.data()), degrees.size() * sizeof(uint32_t));
+    b.append(reinterpret_cast<const char *>(keys.data()), keys.size() * sizeof(uint64_t));
+    return b;
+}
+
+static void bheap_shape() {
+    using Heap = alg::Bheap<uint64_t>;
+    // B0(5), B1(1 -> 2)
+    std::istringstream in(bheap_bytes({0, 1, 0}, {5, 1, 2}));
+    Heap h;
+    h.load(in);
+    CHECK(h.size() == 3 && h.pop() == 1 && h.pop() == 2 && h.pop() == 5);
+    // B2(1 -> B1(3 -> 4), B0(2))
+    CHECK(!load_throws<Heap>(bheap_bytes({2, 1, 0, 0}, {1, 3, 4, 2}), true));
+    CHECK(load_throws<Heap>(bheap_bytes({1, 0, 0}, {1, 2, 5}), true));         // roots out of order
+    CHECK(load_throws<Heap>(bheap_bytes({0, 0}, {1, 2}), true));               // equal root degrees
+    CHECK(load_throws<Heap>(bheap_bytes({2, 0, 1, 0}, {1, 2, 3, 4}), true));   // children out of order
+    CHECK(load_throws<Heap>(bheap_bytes({2, 1, 1, 0}, {1, 2, 3, 4}), true));   // child of wrong degree
+    CHECK(load_throws<Heap>(bheap_bytes({1, 0}, {5, 1}), true));               // child less than parent
+    CHECK(load_throws<Heap>(bheap_bytes({2, 1, 0}, {1, 2, 3}), true));         // missing child
+}
+
+int main() {
+    bheap_shape();
+    run<alg::Bheap<uint64_t>>("Bheap");
+    run<alg::FibHeap<uint64_t>>("FibHeap");
+    return 0;
+}
@@ -0,0 +1,112 @@
+// HuffmanBuilder: optimal code cost on random alphabets, limited codes
+// are complete and within the limit, Fibonacci frequencies whose optimal
+// code is deeper than 64 bits are limited to 64
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+#include "HuffmanCode.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+using u128 = unsigned __int128;
+
+// sum of freq * length of an optimal code: every merge adds its weight
+static u128 huffman_cost(const std::vector<uint64_t> &freq) {
+    std::priority_queue<u128, std::vector<u128>, std::greater<u128>> q;
+    for (uint64_t f : freq)
+        if (f)
+            q.push(f);
+    if (q.size() == 1)
+        return q.top();
+    u128 cost = 0;
+    while (q.size() > 1) {
+        u128 a = q.top();
+        q.pop();
+        u128 b = q.top();
+        q.pop();
+        cost += a + b;
+        q.push(a + b);
+    }
+    return cost;
+}
+
+// lengths within limit, Kraft sum exactly 1, canonical codes distinct
+static u128 check_code(const std::vector<uint64_t> &freq, const std::vector<uint8_t> &len,
+                       unsigned limit) {
+    u128 kraft = 0, cost = 0;
+    size_t used = 0;
+    for (size_t i = 0; i < freq.size(); i++) {
+        CHECK((freq[i] == 0) == (len[i] == 0));
+        CHECK(len[i] <= limit);
+        if (len[i]) {
+            kraft += u128(1) << (64 - len[i]);
+            cost += u128(freq[i]) * len[i];
+            used++;
+        }
+    }
+    if (used > 1)
+        CHECK(kraft == u128(1) << 64);
+    std::vector<uint64_t> codes(freq.size());
+    alg::HuffmanBuilder::canonical(len.data(), len.size(), codes.data());
+    for (size_t i = 0; i < freq.size(); i++) {
+        for (size_t j = i + 1; j < freq.size() && len[i] && j < i + 64; j++) {
+            if (!len[j])
+                continue;
+            // neither code is a prefix of the other
+            unsigned l = std::min(len[i], len[j]);
+            CHECK((codes[i] >> (len[i] - l)) != (codes[j] >> (len[j] - l)));
+        }
+    }
+    return cost;
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    alg::HuffmanBuilder hb;
+
+    for (int t = 0; t < 300; t++) {
+        size_t n = t % 3 == 0 ? rng() % 40 + 1 : rng() % 3000 + 1;
+        std::vector<uint64_t> freq(n);
+        for (auto &f : freq)
+            f = rng() % 4 == 0 ? 0 : (rng() % 1000 + 1) << (rng() % 20);
+        if (t % 5 == 0)
+            std::sort(freq.begin(), freq.end());
+        std::vector<uint8_t> len(n);
+        hb.lengths(freq.data(), n, len.data());
+        CHECK(check_code(freq, len, 64) == huffman_cost(freq));
+        u128 opt = huffman_cost(freq);
+        for (unsigned limit : {12u, 15u}) {
+            size_t used = size_t(std::count_if(freq.begin(), freq.end(), [](uint64_t f) { return f != 0; }));
+            if (used > (size_t(1) << limit))
+                continue;
+            hb.lengths(freq.data(), n, len.data(), limit);
+            CHECK(check_code(freq, len, limit) >= opt);
+        }
+    }
+
+    // Fibonacci frequencies: unlimited Huffman code is 89 bits deep
+    {
+        std::vector<uint64_t> freq(90);
+        freq[0] = freq[1] = 1;
+        for (size_t i = 2; i < freq.size(); i++)
+            freq[i] = freq[i - 1] + freq[i - 2];
+        std::shuffle(freq.begin(), freq.end(), rng);
+        for (unsigned limit : {0u, 64u, 100u}) {
+            std::vector<uint8_t> len(freq.size());
+            hb.lengths(freq.data(), freq.size(), len.data(), limit);
+            unsigned longest = 0;
+            for (uint8_t l : len)
+                longest = std::max<unsigned>(longest, l);
+            CHECK(longest == 64);
+            check_code(freq, len, 64);
+        }
+    }
+
+    std::printf("huffman_code ok\n");
+    return 0;
+}
@@ -0,0 +1,58 @@
+// LoserTree: output is sorted, ties in run order, one comparison per level
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "KWayMerge.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+struct Item {
+    int key;
+    int run;
+};
+struct KeyLess {
+    size_t *count;
+    bool operator () (const Item &a, const Item &b) const {
+        ++*count;
+        return a.key < b.key;
+    }
+};
+
+int main() {
+    using Run = alg::IteratorRun<std::vector<Item>::const_iterator>;
+    std::mt19937_64 rng(1);
+    for (size_t k : {size_t(1), size_t(2), size_t(5), size_t(16), size_t(100)}) {
+        std::vector<std::vector<Item>> data(k);
+        size_t total = 0;
+        for (size_t r = 0; r < k; r++) {
+            size_t n = rng() % 300;
+            for (size_t i = 0; i < n; i++)
+                data[r].push_back(Item{int(rng() % 50), int(r)});
+            std::sort(data[r].begin(), data[r].end(),
+                      [](const Item &a, const Item &b) { return a.key < b.key; });
+            total += n;
+        }
+        std::vector<Run> runs;
+        for (auto &d : data)
+            runs.emplace_back(d.cbegin(), d.cend());
+        size_t count = 0;
+        alg::LoserTree<Run, KeyLess> tree(runs, KeyLess{&count});
+        count = 0;
+        std::vector<Item> out;
+        tree.pop_all(std::back_inserter(out));
+        CHECK(out.size() == total);
+        for (size_t i = 1; i < out.size(); i++) {
+            CHECK(out[i - 1].key <= out[i].key);
+            if (out[i - 1].key == out[i].key)
+                CHECK(out[i - 1].run <= out[i].run);
+        }
+        size_t levels = 0;
+        while ((size_t(1) << levels) < k)
+            levels++;
+        CHECK(count <= total * levels);
+    }
+    std::printf("kway_merge ok\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+// LoadBuckets: min and round robin order match a naive reference, loads
+// are bounded; ConcurrentLeastLoaded never compares a server with itself
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "LeastLoaded.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+template <typename F>
+static bool throws(F f) {
+    try {
+        f();
+    } catch (const std::exception &) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+
+    // loads spread over several bitmap words and summary words
+    for (uint32_t max_load : {100u, 5000u, 300000u}) {
+        alg::LoadBuckets lb(max_load);
+        std::vector<int64_t> load;  // -1 for erased ids
+        std::vector<uint64_t> seq;  // order of arrival in the current bucket
+        uint64_t clock = 0;
+        auto expect_min = [&]() {
+            long best = -1;
+            for (size_t i = 0; i < load.size(); i++) {
+                if (load[i] < 0)
+                    continue;
+                if (best < 0 || load[i] < load[size_t(best)]
+                    || (load[i] == load[size_t(best)] && seq[i] < seq[size_t(best)]))
+                    best = long(i);
+            }
+            return best;
+        };
+        for (int op = 0; op < 20000; op++) {
+            uint64_t c = rng() % 10;
+            if (c < 2 || lb.size() == 0) {
+                uint32_t l = uint32_t(rng() % (max_load + 1));
+                uint32_t id = lb.insert(l);
+                if (id >= load.size()) {
+                    load.resize(id + 1, -1);
+                    seq.resize(id + 1);
+                }
+                load[id] = l;
+                seq[id] = clock++;
+            } else if (c < 3) {
+                uint32_t id = lb.pop();
+                CHECK(long(id) == expect_min());
+                load[id] = -1;
+            } else {
+                long best = expect_min();
+                CHECK(lb.get_min() == uint32_t(best) && lb.min_load() == load[size_t(best)]);
+                size_t id = size_t(best);
+                if (c < 6) {
+                    for (size_t k = rng() % load.size(); ; k = (k + 1) % load.size()) {
+                        if (load[k] >= 0) {
+                            id = k;
+                            break;
+                        }
+                    }
+                }
+                uint32_t l = uint32_t(rng() % (max_load + 1));
+                if (c < 8 && load[id] < int64_t(max_load)) {
+                    CHECK(lb.acquire() == uint32_t(best));
+                    id = size_t(best);
+                    l = uint32_t(load[id] + 1);
+                } else {
+                    lb.set_load(uint32_t(id), l);
+                }
+                load[id] = l;
+                seq[id] = clock++;
+            }
+            CHECK(lb.size() == size_t(std::count_if(load.begin(), load.end(),
+                                                    [](int64_t l) { return l >= 0; })));
+        }
+        uint32_t id = lb.get_min();
+        CHECK(throws([&] { lb.set_load(id, UINT32_MAX); }));
+        CHECK(throws([&] { lb.set_load(id, max_load + 1); }));
+        CHECK(throws([&] { lb.insert(max_load + 1); }));
+        CHECK(throws([&] { lb.decrease_key(id, lb.get_load(id) + 1); }));
+        lb.set_load(id, max_load);
+        CHECK(throws([&] { lb.increase(id); }));
+        lb.decrease_key(id, 0);
+        CHECK(lb.get_min() == id && lb.min_load() == 0);
+    }
+
+    // two servers: every acquire sees both, so loads never differ by 2
+    {
+        alg::ConcurrentLeastLoaded cl(2);
+        for (int i = 0; i < 10000; i++) {
+            cl.acquire();
+            int64_t d = int64_t(cl.get_load(0)) - int64_t(cl.get_load(1));
+            CHECK(d >= -1 && d <= 1);
+        }
+        alg::ConcurrentLeastLoaded one(1);
+        CHECK(one.acquire() == 0 && one.acquire() == 0 && one.get_load(0) == 2);
+        CHECK(throws([&] { one.get_load(1); }));
+        CHECK(throws([&] { one.release(1); }));
+    }
+
+    std::printf("least_loaded ok\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+// MappedFibHeap: reopen restores the heap, a killed process reopens in
+// the state of its last sync(), torn journals are dropped
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "MappedFibHeap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+using Heap = alg::MappedFibHeap<uint64_t>;
+
+static std::string path;
+
+static void remove_files() {
+    unlink(path.c_str());
+    unlink((path + ".journal").c_str());
+}
+
+// rounds of 100 inserts and 50 pops, synced after each round
+static void rounds(Heap &heap, uint64_t from, uint64_t to) {
+    for (uint64_t r = from; r < to; r++) {
+        for (uint64_t i = 0; i < 100; i++)
+            heap.insert(r * 100 + (i * 37) % 100);
+        for (int i = 0; i < 50; i++)
+            heap.pop();
+        heap.sync();
+    }
+}
+// after r rounds heap holds [50r, 100r)
+static uint64_t check_rounds(Heap &heap) {
+    CHECK(heap.size() % 50 == 0);
+    uint64_t r = heap.size() / 50;
+    for (uint64_t k = 50 * r; k < 100 * r; k++)
+        CHECK(heap.pop() == k);
+    CHECK(heap.size() == 0);
+    return r;
+}
+
+int main() {
+    char dir[] = "/tmp/mapped_fib_heap_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    path = std::string(dir) + "/heap";
+    std::mt19937_64 rng(1);
+
+    // random operations against a multiset, reopened every 1000 of them
+    {
+        std::multiset<std::pair<uint64_t, uint32_t>> ref;
+        std::vector<Heap::Handle> handles;
+        std::vector<uint64_t> keys;
+        for (int reopen = 0; reopen < 10; reopen++) {
+            Heap heap(path);
+            CHECK(heap.size() == ref.size());
+            for (int op = 0; op < 1000; op++) {
+                uint64_t c = rng() % 10;
+                if (c < 5 || ref.empty()) {
+                    uint64_t k = rng() % 100000 + 1000;
+                    Heap::Handle x = heap.insert(k);
+                    ref.insert({k, x});
+                } else if (c < 7) {
+                    auto it = ref.begin();
+                    CHECK(heap.get_min() == it->first);
+                    CHECK(heap.pop() == it->first);
+                    ref.erase(it);
+                } else if (c < 9) {
+                    auto it = std::next(ref.begin(), rng() % ref.size());
+                    uint64_t k = it->first - rng() % 1000;
+                    Heap::Handle x = it->second;
+                    heap.decrease_key(x, k);
+                    ref.erase(it);
+                    ref.insert({k, x});
+                } else {
+                    auto it = std::next(ref.begin(), rng() % ref.size());
+                    heap.erase(it->second);
+                    ref.erase(it);
+                }
+            }
+        }
+        Heap heap(path);
+        for (auto &e : ref)
+            CHECK(heap.pop() == e.first);
+        CHECK(heap.size() == 0);
+    }
+
+    // changes after the last sync are gone after a crash
+    remove_files();
+    {
+        pid_t pid = fork();
+        if (pid == 0) {
+            Heap heap(path);
+            rounds(heap, 0, 30);
+            for (int i = 0; i < 5000; i++)
+                heap.insert(i);
+            _exit(0);
+        }
+        int status;
+        CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status));
+        Heap heap(path);
+        CHECK(check_rounds(heap) == 30);
+    }
+
+    // killed at random points, also inside sync() and grow()
+    for (int kill = 0; kill < 30; kill++) {
+        remove_files();
+        pid_t pid = fork();
+        if (pid == 0) {
+            Heap heap(path);
+            rounds(heap, 0, 1000000);
+            _exit(0);
+        }
+        usleep(useconds_t(rng() % 50000));
+        ::kill(pid, SIGKILL);
+        int status;
+        CHECK(waitpid(pid, &status, 0) == pid);
+        Heap heap(path);
+        uint64_t r = check_rounds(heap);
+        heap.close();
+        // heap works on after recovery
+        Heap again(path);
+        rounds(again, 0, 3);
+        again.close();
+        Heap last(path);
+        CHECK(check_rounds(last) == 3);
+        (void)r;
+    }
+
+    // journal without commit record is dropped
+    remove_files();
+    {
+        Heap heap(path);
+        rounds(heap, 0, 4);
+    }
+    {
+        int f = open((path + ".journal").c_str(), O_WRONLY);
+        CHECK(f >= 0);
+        uint64_t torn[64];
+        for (auto &x : torn)
+            x = rng();
+        torn[0] = 0x4c4e524a424946ull;
+        CHECK(write(f, torn, sizeof(torn)) == ssize_t(sizeof(torn)));
+        close(f);
+        Heap heap(path);
+        CHECK(check_rounds(heap) == 4);
+    }
+
+    remove_files();
+    rmdir(dir);
+    std::printf("mapped_fib_heap ok\n");
+    return 0;
+}
@@ -0,0 +1,133 @@
+// MinMaxHeap: both ends, erase and update through handles match a
+// multiset; handles of removed elements stay invalid after their id is
+// reused; get_max and pop_max on sizes 0-3
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+#include "MinMaxHeap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+using Heap = alg::MinMaxHeap<int>;
+
+template <typename F>
+static bool throws(F f) {
+    try {
+        f();
+    } catch (const std::out_of_range &) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    // small sizes, max_index() picks among root and its two children
+    {
+        Heap h;
+        CHECK(throws([&] { h.get_max(); }) && throws([&] { h.pop_min(); })
+              && throws([&] { h.pop_max(); }) && throws([&] { h.get_min(); }));
+        const int perms[][3] = {{1, 2, 3}, {1, 3, 2}, {2, 1, 3}, {2, 3, 1}, {3, 1, 2}, {3, 2, 1}};
+        for (auto &p : perms) {
+            for (int n = 1; n <= 3; n++) {
+                Heap a, b;
+                int lo = 4, hi = 0;
+                for (int i = 0; i < n; i++) {
+                    a.insert(p[i]);
+                    b.insert(p[i]);
+                    lo = std::min(lo, p[i]);
+                    hi = std::max(hi, p[i]);
+                }
+                CHECK(a.get_min() == lo && a.get_max() == hi);
+                CHECK(a.pop_max() == hi && b.pop_min() == lo);
+                CHECK(a.size() == size_t(n - 1) && b.size() == size_t(n - 1));
+                if (n > 1)
+                    CHECK(a.get_min() == lo && b.get_max() == hi);
+            }
+        }
+    }
+
+    std::mt19937_64 rng(1);
+    Heap h;
+    std::multiset<std::pair<int, size_t>> ref;  // key, index in handles
+    std::vector<Heap::Handle> handles;
+    std::vector<int> keys;
+    std::vector<char> live;
+    auto remove_ref = [&](int key) {
+        // any element with this key; find which one the heap removed by
+        // checking the handles
+        for (auto it = ref.lower_bound({key, 0}); it != ref.end() && it->first == key; ++it) {
+            if (!h.contains(handles[it->second])) {
+                live[it->second] = 0;
+                ref.erase(it);
+                return;
+            }
+        }
+        CHECK(false);
+    };
+    for (int op = 0; op < 200000; op++) {
+        uint64_t c = rng() % 10;
+        size_t target = op < 100000 ? 2000 : 50;
+        if (c < 4 || ref.empty() || (ref.size() < target && c < 6)) {
+            int k = int(rng() % 1000);
+            handles.push_back(h.insert(k));
+            keys.push_back(k);
+            live.push_back(1);
+            ref.insert({k, handles.size() - 1});
+        } else if (c < 5) {
+            CHECK(h.get_min() == ref.begin()->first);
+            remove_ref(h.pop_min());
+        } else if (c < 6) {
+            CHECK(h.get_max() == ref.rbegin()->first);
+            remove_ref(h.pop_max());
+        } else {
+            size_t i = rng() % handles.size();
+            if (c < 7) {
+                CHECK(h.erase(handles[i]) == bool(live[i]));
+                if (live[i]) {
+                    ref.erase({keys[i], i});
+                    live[i] = 0;
+                }
+            } else {
+                // update up, down or to the same key
+                int k = keys[i] + int(rng() % 401) - 200;
+                CHECK(h.update(handles[i], k) == bool(live[i]));
+                if (live[i]) {
+                    ref.erase({keys[i], i});
+                    keys[i] = k;
+                    ref.insert({k, i});
+                }
+            }
+        }
+        CHECK(h.size() == ref.size());
+        if (!ref.empty())
+            CHECK(h.get_min() == ref.begin()->first && h.get_max() == ref.rbegin()->first);
+    }
+    // every handle agrees with its element, removed ones stay removed
+    // although their ids were reused by later inserts
+    size_t stale = 0;
+    for (size_t i = 0; i < handles.size(); i++) {
+        CHECK(h.contains(handles[i]) == bool(live[i]));
+        if (live[i]) {
+            CHECK(h.get_key(handles[i]) == keys[i]);
+        } else {
+            stale++;
+            CHECK(throws([&] { h.get_key(handles[i]); }));
+            CHECK(!h.update(handles[i], 0) && !h.erase(handles[i]));
+        }
+    }
+    CHECK(stale > 0 && handles.size() > 2 * h.size());
+    size_t n = 0;
+    h.for_each([&](int) { n++; });
+    CHECK(n == ref.size());
+    while (!h.empty()) {
+        int lo = h.get_min();
+        CHECK(h.pop_min() == lo && (h.empty() || h.get_min() >= lo));
+    }
+    std::printf("min_max_heap ok\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+// OrderBook: fills and book state match a naive reference book, fill
+// callbacks may add and cancel orders
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "OrderBook.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+using Book = alg::OrderBook<int64_t, uint64_t>;
+using Fill = std::tuple<uint64_t, uint64_t, int64_t, uint64_t>;
+
+// resting orders in a vector, best by scan
+struct Reference {
+    struct Order {
+        uint64_t id;
+        int side;
+        int64_t price;
+        uint64_t qty;
+        uint64_t seq;
+    };
+    std::vector<Order> orders;
+    uint64_t seq = 0;
+
+    long best(int side) const {
+        long b = -1;
+        for (size_t i = 0; i < orders.size(); i++) {
+            const Order &o = orders[i];
+            if (o.side != side)
+                continue;
+            if (b < 0)
+                b = long(i);
+            const Order &c = orders[size_t(b)];
+            bool better = side == Book::BID ? o.price > c.price : o.price < c.price;
+            if (better || (o.price == c.price && o.seq < c.seq))
+                b = long(i);
+        }
+        return b;
+    }
+    template <typename OnFill>
+    uint64_t limit(uint64_t id, Book::Side side, int64_t price, uint64_t qty, OnFill on_fill) {
+        std::vector<Fill> fills;
+        long b;
+        while (qty > 0 && (b = best(side == Book::BID ? Book::ASK : Book::BID)) >= 0) {
+            Order &o = orders[size_t(b)];
+            if (side == Book::BID ? o.price > price : o.price < price)
+                break;
+            uint64_t q = std::min(o.qty, qty);
+            fills.emplace_back(o.id, id, o.price, q);
+            o.qty -= q;
+            qty -= q;
+            if (o.qty == 0)
+                orders.erase(orders.begin() + b);
+        }
+        if (qty > 0)
+            orders.push_back(Order{id, side, price, qty, seq++});
+        for (auto &f : fills)
+            on_fill(std::get<0>(f), std::get<1>(f), std::get<2>(f), std::get<3>(f));
+        return qty;
+    }
+    bool cancel(uint64_t id) {
+        for (size_t i = 0; i < orders.size(); i++) {
+            if (orders[i].id == id) {
+                orders.erase(orders.begin() + long(i));
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// every 7th fill places an order from the callback, every 5th cancels
+struct Nested {
+    uint64_t &nested_id;
+    template <typename B, typename Log>
+    void run(B &b, Log &log, uint64_t maker, uint64_t taker, int64_t price, uint64_t qty) {
+        log.emplace_back(maker, taker, price, qty);
+        if (maker % 7 == 0) {
+            uint64_t id = nested_id++;
+            b.limit(id, Book::Side(maker % 2), price + int64_t(maker % 3) - 1, qty,
+                    [&](uint64_t m, uint64_t t, int64_t p, uint64_t q) { log.emplace_back(m, t, p, q); });
+        }
+        if (maker % 5 == 0)
+            b.cancel(maker + 1);
+    }
+};
+
+int main() {
+    std::mt19937_64 rng(1);
+    Book book;
+    Reference ref;
+    std::vector<Fill> got, want;
+    uint64_t next_id = 1;
+    uint64_t nested_id = 1000000000;
+
+    Nested nested_book{nested_id};
+    uint64_t nested_ref_id = 1000000000;
+    Nested nested_ref{nested_ref_id};
+
+    for (int op = 0; op < 20000; op++) {
+        uint64_t c = rng() % 10;
+        if (c < 7) {
+            uint64_t id = next_id++;
+            int side = int(rng() % 2);
+            int64_t price = 100 + int64_t(rng() % 21) - 10;
+            uint64_t qty = rng() % 50 + 1;
+            uint64_t r1 = book.limit(id, Book::Side(side), price, qty,
+                                     [&](uint64_t m, uint64_t t, int64_t p, uint64_t q) {
+                                         nested_book.run(book, got, m, t, p, q);
+                                     });
+            uint64_t r2 = ref.limit(id, Book::Side(side), price, qty,
+                                    [&](uint64_t m, uint64_t t, int64_t p, uint64_t q) {
+                                        nested_ref.run(ref, want, m, t, p, q);
+                                    });
+            CHECK(r1 == r2);
+        } else {
+            uint64_t id = rng() % next_id + 1;
+            CHECK(book.cancel(id) == ref.cancel(id));
+        }
+        CHECK(got == want);
+        CHECK(book.size() == ref.orders.size());
+        for (int side = 0; side < 2; side++) {
+            int64_t price;
+            uint64_t qty;
+            long b = ref.best(side);
+            CHECK(book.best(Book::Side(side), price, qty) == (b >= 0));
+            if (b >= 0)
+                CHECK(price == ref.orders[size_t(b)].price
+                      && qty == book.level_qty(Book::Side(side), price));
+        }
+    }
+    CHECK(nested_id > 1000000000);
+    std::printf("order_book ok\n");
+    return 0;
+}
@@ -0,0 +1,129 @@
+// PersistentHeap: versions made by copies, insert, pop, add_heap and the
+// inserted/popped/merged forms stay independent and each matches its own
+// sorted reference; heaps with a 300000-node left spine and shared
+// subtrees are destroyed without recursion
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "PersistentHeap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+using Heap = alg::PersistentHeap<int>;
+
+struct Version {
+    Heap h;
+    std::vector<int> ref;   // sorted
+};
+
+static void insert_ref(std::vector<int> &ref, int x) {
+    ref.insert(std::upper_bound(ref.begin(), ref.end(), x), x);
+}
+
+static void check_all(Heap h, const std::vector<int> &ref) {
+    CHECK(h.size() == ref.size());
+    for (int x : ref)
+        CHECK(h.pop() == x);
+    CHECK(h.empty());
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    std::vector<Version> v(1);
+    for (int op = 0; op < 20000; op++) {
+        size_t i = rng() % v.size();
+        size_t j = rng() % v.size();
+        int x = int(rng() % 1000);
+        switch (rng() % 7) {
+        case 0:
+            if (v.size() < 64)
+                v.push_back(v[i]);
+            break;
+        case 1:
+            v[i].h.insert(x);
+            insert_ref(v[i].ref, x);
+            break;
+        case 2:
+            if (!v[i].h.empty()) {
+                CHECK(v[i].h.get_min() == v[i].ref.front());
+                CHECK(v[i].h.pop() == v[i].ref.front());
+                v[i].ref.erase(v[i].ref.begin());
+            }
+            break;
+        case 3:
+            if (v[i].ref.size() + v[j].ref.size() < 500) {
+                v[i].h.add_heap(v[j].h);   // j may be i
+                std::vector<int> m;
+                std::merge(v[i].ref.begin(), v[i].ref.end(), v[j].ref.begin(), v[j].ref.end(),
+                           std::back_inserter(m));
+                v[i].ref = m;
+            }
+            break;
+        case 4: {
+            Version n{v[i].h.inserted(x), v[i].ref};
+            insert_ref(n.ref, x);
+            v[rng() % v.size()] = n;
+            break;
+        }
+        case 5:
+            if (!v[i].h.empty()) {
+                Version n{v[i].h.popped(), v[i].ref};
+                n.ref.erase(n.ref.begin());
+                v[rng() % v.size()] = n;
+            }
+            break;
+        case 6:
+            if (v[i].ref.size() + v[j].ref.size() < 500) {
+                Version n{v[i].h.merged(v[j].h), {}};
+                std::merge(v[i].ref.begin(), v[i].ref.end(), v[j].ref.begin(), v[j].ref.end(),
+                           std::back_inserter(n.ref));
+                v[rng() % v.size()] = n;
+            }
+            break;
+        }
+        if (op % 1000 == 0) {
+            for (auto &d : v)
+                check_all(d.h, d.ref);
+        }
+    }
+    for (auto &d : v)
+        check_all(d.h, d.ref);
+
+    {
+        // descending inserts put every node on the left spine
+        Heap h;
+        for (int i = 300000; i > 0; i--)
+            h.insert(i);
+        Heap old = h;
+        for (int i = 0; i < 1000; i++)
+            h.pop();
+        CHECK(old.size() == 300000 && old.get_min() == 1);
+        old = Heap();       // most nodes are still shared with h
+        CHECK(h.get_min() == 1001);
+        Heap other;
+        for (int i = 0; i < 100000; i++)
+            other.insert(int(rng() % 1000000));
+        h.add_heap(other);
+        other = Heap();
+        CHECK(h.size() == 300000 - 1000 + 100000);
+        int prev = h.pop();
+        for (int i = 0; i < 1000; i++) {
+            int x = h.pop();
+            CHECK(prev <= x);
+            prev = x;
+        }
+    }
+    bool thrown = false;
+    try {
+        Heap().pop();
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    std::printf("persistent_heap ok\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+// QueueServer: pipelined batches match a reference queue, batches sent
+// before a shutdown are answered, a client that reads late gets all
+// of its replies
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <set>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "QueueServer.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+// QueueServer keeps jobs in a FibHeap, whose nodes leak shared_ptr cycles
+extern "C" const char *__asan_default_options() {
+    return "detect_leaks=0";
+}
+
+using namespace alg::queue_service;
+using Client = alg::QueueClient<uint64_t>;
+using Rec = Record<uint64_t>;
+
+int main() {
+    std::string path = "/tmp/alg_queue_server_" + std::to_string(getpid()) + ".sock";
+    alg::QueueServer<uint64_t> server(path);
+    std::thread loop([&] { server.run(); });
+    std::mt19937_64 rng(1);
+
+    // random batches, up to 4 in flight, against a reference
+    {
+        Client client(path);
+        std::set<std::pair<uint64_t, JobId>> ref;
+        std::map<JobId, uint64_t> keys;
+        std::vector<std::vector<int>> expect;  // op per request of each batch
+        std::vector<std::vector<uint64_t>> args;
+        auto check_reply = [&](const std::vector<int> &ops, const std::vector<uint64_t> &a) {
+            std::vector<Client::Reply> rep = client.receive();
+            CHECK(rep.size() == ops.size());
+            for (size_t i = 0; i < ops.size(); i++) {
+                if (ops[i] == OP_INSERT) {
+                    CHECK(rep[i].status == OK && rep[i].key == a[i]);
+                    ref.insert({a[i], rep[i].id});
+                    keys[rep[i].id] = a[i];
+                } else if (ops[i] == OP_POP) {
+                    if (ref.empty()) {
+                        CHECK(rep[i].status == EMPTY);
+                    } else {
+                        CHECK(rep[i].status == OK);
+                        CHECK(rep[i].key == ref.begin()->first && rep[i].id == ref.begin()->second);
+                        keys.erase(rep[i].id);
+                        ref.erase(ref.begin());
+                    }
+                }
+            }
+        };
+        for (int b = 0; b < 300; b++) {
+            std::vector<int> ops;
+            std::vector<uint64_t> a;
+            size_t n = rng() % 200 + 1;
+            // runs of the same op, as load generators send them
+            while (ops.size() < n) {
+                int op = rng() % 3 == 0 ? OP_POP : OP_INSERT;
+                for (size_t r = rng() % 20 + 1; r > 0 && ops.size() < n; r--) {
+                    ops.push_back(op);
+                    a.push_back(rng() % 100000);
+                    if (op == OP_INSERT)
+                        client.insert(a.back());
+                    else
+                        client.pop();
+                }
+            }
+            client.send();
+            expect.push_back(ops);
+            args.push_back(a);
+            if (expect.size() == 4) {
+                check_reply(expect[0], args[0]);
+                expect.erase(expect.begin());
+                args.erase(args.begin());
+            }
+            // decrease_key is synchronous, its id must be known
+            if (b % 10 == 0) {
+                for (size_t i = 0; i < expect.size(); i++)
+                    check_reply(expect[i], args[i]);
+                expect.clear();
+                args.clear();
+                if (!keys.empty()) {
+                    auto it = std::next(keys.begin(), rng() % keys.size());
+                    uint64_t k = it->second - rng() % 100;
+                    client.decrease_key(it->first, k);
+                    std::vector<Client::Reply> rep = client.execute();
+                    CHECK(rep.size() == 1 && rep[0].status == OK);
+                    ref.erase({it->second, it->first});
+                    ref.insert({k, it->first});
+                    it->second = k;
+                }
+                client.decrease_key(0, 1);
+                CHECK(client.execute()[0].status == NOT_FOUND);
+            }
+        }
+        for (size_t i = 0; i < expect.size(); i++)
+            check_reply(expect[i], args[i]);
+        // drain
+        while (!ref.empty()) {
+            client.pop();
+            std::vector<Client::Reply> rep = client.execute();
+            CHECK(rep[0].status == OK && rep[0].key == ref.begin()->first);
+            ref.erase(ref.begin());
+        }
+    }
+
+    // batches sent right before shutdown(SHUT_WR) are answered, a torn one
+    // after them is dropped
+    {
+        sockaddr_un addr;
+        unix_address(path, addr);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        CHECK(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+        std::vector<char> req;
+        auto batch = [&](uint32_t count, uint8_t op) {
+            size_t off = req.size();
+            req.resize(off + 4 + count * Rec::SIZE);
+            std::memcpy(&req[off], &count, 4);
+            for (uint32_t i = 0; i < count; i++)
+                Rec{op, 0, uint64_t(1000 - i)}.encode(&req[off + 4 + i * Rec::SIZE]);
+        };
+        batch(100, OP_INSERT);
+        batch(5, OP_POP);
+        req.push_back(char(1));
+        CHECK(write(fd, req.data(), req.size()) == ssize_t(req.size()));
+        CHECK(shutdown(fd, SHUT_WR) == 0);
+        std::vector<char> rep;
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+            rep.insert(rep.end(), buf, buf + n);
+        close(fd);
+        CHECK(rep.size() == 8 + 105 * Rec::SIZE);
+        Rec last = Rec::decode(&rep[8 + 104 * Rec::SIZE]);
+        CHECK(last.code == OK && last.key == 905);
+        Client client(path);
+        for (int i = 0; i < 95; i++)
+            client.pop();
+        std::vector<Client::Reply> left = client.execute();
+        CHECK(left.size() == 95 && left[94].status == OK && left[94].key == 1000);
+    }
+
+    // client sends 8 MB of requests before reading any reply
+    {
+        Client client(path);
+        const int BATCHES = 64, COUNT = 8192;
+        std::thread sender([&] {
+            for (int b = 0; b < BATCHES; b++) {
+                for (int i = 0; i < COUNT; i++)
+                    client.insert(uint64_t(b) * COUNT + i);
+                client.send();
+            }
+        });
+        usleep(100000);
+        for (int b = 0; b < BATCHES; b++) {
+            std::vector<Client::Reply> rep = client.receive();
+            CHECK(rep.size() == size_t(COUNT) && rep[COUNT - 1].key == uint64_t(b) * COUNT + COUNT - 1);
+        }
+        sender.join();
+        for (int b = 0; b < BATCHES; b++) {
+            for (int i = 0; i < COUNT; i++)
+                client.pop();
+            std::vector<Client::Reply> rep = client.execute();
+            CHECK(rep[0].key == uint64_t(b) * COUNT);
+        }
+    }
+
+    server.stop();
+    loop.join();
+    std::printf("queue_server ok\n");
+    return 0;
+}
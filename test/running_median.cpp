@@ -0,0 +1,113 @@
+// RunningQuantile: get() matches the sorted window for several q, with
+// single pushes, batches with out, batches of at least W/2 values that
+// rebuild the heaps, and clear()
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "RunningMedian.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+template <typename Index>
+static void run(size_t w, double q, int ops, std::mt19937_64 &rng) {
+    alg::RunningQuantile<int, std::less<int>, Index> rq(w, q);
+    std::deque<int> win;
+    std::vector<int> sorted;    // window values in order
+    auto expect = [&]() {
+        return sorted[size_t(q * double(sorted.size() - 1))];
+    };
+    auto add = [&](int x) {
+        win.push_back(x);
+        sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), x), x);
+        if (win.size() > w) {
+            sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), win.front()));
+            win.pop_front();
+        }
+    };
+    int range = rng() % 2 ? 10 : 1000000;
+    std::vector<int> batch, out;
+    for (int op = 0; op < ops; op++) {
+        uint64_t c = rng() % 20;
+        if (c == 0) {
+            rq.clear();
+            win.clear();
+            sorted.clear();
+            CHECK(rq.empty() && rq.size() == 0);
+            continue;
+        }
+        size_t n;
+        if (c < 12)
+            n = 1;
+        else if (c < 15)
+            n = rng() % (w / 2 + 1) + 1;           // mostly below W/2
+        else
+            n = w / 2 + 1 + rng() % (2 * w);       // rebuild path, also longer than W
+        batch.resize(n);
+        for (auto &x : batch)
+            x = int(rng() % uint64_t(range));
+        if (n == 1) {
+            rq.push(batch[0]);
+            add(batch[0]);
+        } else if (c % 2 == 0) {
+            n = std::min<size_t>(n, 2000);  // keeps the reference cheap for the big window
+            out.assign(n, -1);
+            rq.push(batch.data(), n, out.data());
+            for (size_t i = 0; i < n; i++) {
+                add(batch[i]);
+                CHECK(out[i] == expect());
+            }
+        } else {
+            rq.push(batch.data(), n);
+            for (int x : batch)
+                win.push_back(x);
+            while (win.size() > w)
+                win.pop_front();
+            sorted.assign(win.begin(), win.end());
+            std::sort(sorted.begin(), sorted.end());
+        }
+        CHECK(rq.size() == win.size());
+        CHECK(rq.get() == expect());
+        // single pushes after a rebuild keep working
+        int x = int(rng() % uint64_t(range));
+        rq.push(x);
+        add(x);
+        CHECK(rq.get() == expect());
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    for (double q : {0.0, 0.25, 0.5, 0.75, 1.0}) {
+        for (size_t w : {size_t(1), size_t(2), size_t(3), size_t(8), size_t(101)}) {
+            run<uint16_t>(w, q, 600, rng);
+            run<uint32_t>(w, q, 600, rng);
+        }
+    }
+    run<uint16_t>(65535, 0.5, 20, rng);
+
+    alg::RunningMedian<double> rm(4);
+    bool thrown = false;
+    try {
+        rm.median();
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    for (double x : {5.0, 1.0, 3.0, 2.0, 4.0})
+        rm.push(x);
+    CHECK(rm.median() == 2.0);  // lower median of 1 3 2 4
+    thrown = false;
+    try {
+        alg::RunningQuantile<int, std::less<int>, uint16_t> big(65536);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    std::printf("running_median ok\n");
+    return 0;
+}
@@ -0,0 +1,214 @@
+// SearchQueues: FixedHeap push, pop, replace_top and push_bounded match a
+// multiset and keep the heap order; VisitedSet across epoch wrap around;
+// SearchQueues keeps the ef best offers; search_layer with ef covering
+// the whole graph finds the exact nearest vertices
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+#include "SearchQueues.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+template <typename F>
+static bool throws(F f) {
+    try {
+        f();
+    } catch (const std::exception &) {
+        return true;
+    }
+    return false;
+}
+
+template <size_t CAP, typename Compare>
+static void fixed_heap(std::mt19937_64 &rng) {
+    alg::FixedHeap<int, CAP, Compare> h;
+    std::multiset<int, Compare> ref;
+    Compare comp;
+    for (int op = 0; op < 20000; op++) {
+        int x = int(rng() % 50);
+        switch (rng() % 5) {
+        case 0:
+            if (h.full()) {
+                CHECK(throws([&] { h.push(x); }));
+            } else {
+                h.push(x);
+                ref.insert(x);
+            }
+            break;
+        case 1: {
+            // keep the CAP smallest by Compare, the last of ref is the largest
+            bool kept = ref.size() < CAP || comp(x, *ref.rbegin());
+            CHECK(h.push_bounded(x) == kept);
+            if (kept) {
+                if (ref.size() == CAP)
+                    ref.erase(std::prev(ref.end()));
+                ref.insert(x);
+            }
+            break;
+        }
+        case 2:
+            if (ref.empty()) {
+                CHECK(throws([&] { h.pop(); }));
+            } else {
+                CHECK(h.pop() == *ref.begin());
+                ref.erase(ref.begin());
+            }
+            break;
+        case 3:
+            if (ref.empty()) {
+                CHECK(throws([&] { h.replace_top(x); }));
+            } else {
+                h.replace_top(x);
+                ref.erase(ref.begin());
+                ref.insert(x);
+            }
+            break;
+        case 4:
+            if (rng() % 50 == 0) {
+                h.clear();
+                ref.clear();
+            }
+            break;
+        }
+        CHECK(h.size() == ref.size());
+        CHECK(h.full() == (ref.size() == CAP));
+        CHECK(h.empty() == ref.empty());
+        if (!ref.empty())
+            CHECK(h.top() == *ref.begin());
+        const int *a = h.begin();
+        for (size_t i = 1; i < h.size(); i++)
+            CHECK(!comp(a[i], a[(i - 1) / 2]));
+        std::multiset<int, Compare> items(h.begin(), h.end());
+        CHECK(items == ref);
+    }
+}
+
+static void visited_set() {
+    alg::VisitedSet v(10);
+    CHECK(v.size() == 10);
+    CHECK(v.visit(3) && !v.visit(3) && v.visit(4));
+    v.reset();
+    CHECK(v.visit(3) && !v.visit(3));
+    v.resize(20);
+    CHECK(v.size() == 20 && v.visit(19) && v.visit(3));
+
+    // vertices visited once must stay unvisited however many resets
+    // follow, including when the epoch counter wraps around
+    alg::VisitedSet w(12);
+    for (size_t u = 0; u < 12; u++)
+        CHECK(w.visit(u));
+    for (int i = 1; i <= 70000; i++) {
+        w.reset();
+        CHECK(w.visit(0) && !w.visit(0));
+        if (i >= 65530 && i < 65541)
+            CHECK(w.visit(size_t(i - 65529)));
+    }
+}
+
+using Queues = alg::SearchQueues<float, uint32_t, 64>;
+
+static void search_queues(std::mt19937_64 &rng) {
+    Queues q;
+    CHECK(throws([&] { q.reset(0); }));
+    CHECK(throws([&] { q.reset(65); }));
+    for (size_t ef : {size_t(1), size_t(5), size_t(64)}) {
+        q.reset(ef);
+        std::set<Queues::Item> ref;
+        for (uint32_t id = 0; id < 500; id++) {
+            Queues::Item it{float(rng() % 100), id};
+            bool better = ref.size() < ef || it < *ref.rbegin();
+            CHECK(q.offer(it.dist, it.id) == better);
+            if (better) {
+                ref.insert(it);
+                if (ref.size() > ef)
+                    ref.erase(std::prev(ref.end()));
+            }
+            CHECK(q.worst() == ref.rbegin()->dist);
+        }
+        std::vector<Queues::Item> res;
+        q.results(res);
+        CHECK(res.size() == ref.size());
+        CHECK(std::equal(res.begin(), res.end(), ref.begin(), [](auto &a, auto &b) {
+            return a.dist == b.dist && a.id == b.id;
+        }));
+        // candidates come out closest first and stop past the worst result
+        Queues::Item c, prev{-1, 0};
+        while (q.next(c)) {
+            CHECK(!(c < prev));
+            CHECK(!(*ref.rbegin() < c));
+            prev = c;
+        }
+    }
+}
+
+static void graph(std::mt19937_64 &rng) {
+    const uint32_t n = 60;
+    std::vector<float> x(n), y(n);
+    for (uint32_t i = 0; i < n; i++) {
+        x[i] = float(rng() % 1000);
+        y[i] = float(rng() % 1000);
+    }
+    // ring plus random edges, connected
+    std::vector<std::vector<uint32_t>> adj(n);
+    for (uint32_t i = 0; i < n; i++) {
+        adj[i].push_back((i + 1) % n);
+        adj[(i + 1) % n].push_back(i);
+        uint32_t j = uint32_t(rng() % n);
+        adj[i].push_back(j);
+        adj[j].push_back(i);
+    }
+    Queues q;
+    alg::VisitedSet visited(n);
+    std::vector<Queues::Item> res;
+    for (int round = 0; round < 50; round++) {
+        float qx = float(rng() % 1000), qy = float(rng() % 1000);
+        auto distance = [&](uint32_t v) {
+            return (x[v] - qx) * (x[v] - qx) + (y[v] - qy) * (y[v] - qy);
+        };
+        auto neighbors = [&](uint32_t v) -> const std::vector<uint32_t> & {
+            return adj[v];
+        };
+        std::vector<Queues::Item> all;
+        for (uint32_t v = 0; v < n; v++)
+            all.push_back(Queues::Item{distance(v), v});
+        std::sort(all.begin(), all.end());
+
+        uint32_t entry = uint32_t(rng() % n);
+        alg::search_layer(q, visited, entry, n, neighbors, distance);
+        q.results(res);
+        CHECK(res.size() == n);
+        for (uint32_t i = 0; i < n; i++)
+            CHECK(res[i].id == all[i].id && res[i].dist == all[i].dist);
+
+        // smaller ef: sorted, distinct, true distances
+        alg::search_layer(q, visited, entry, 8, neighbors, distance);
+        q.results(res);
+        CHECK(res.size() == 8);
+        std::set<uint32_t> ids;
+        for (size_t i = 0; i < res.size(); i++) {
+            CHECK(res[i].dist == distance(res[i].id));
+            CHECK(i == 0 || res[i - 1] < res[i]);
+            ids.insert(res[i].id);
+        }
+        CHECK(ids.size() == 8);
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    fixed_heap<1, std::less<int>>(rng);
+    fixed_heap<8, std::less<int>>(rng);
+    fixed_heap<13, std::less<int>>(rng);
+    fixed_heap<13, std::greater<int>>(rng);
+    visited_set();
+    search_queues(rng);
+    graph(rng);
+    std::printf("search_queues ok\n");
+    return 0;
+}
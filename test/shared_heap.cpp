@@ -0,0 +1,108 @@
+// SharedHeap: several processes push and pop, a creator that died before
+// init doesn't block openers, a process killed inside an operation
+// leaves a valid heap
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "SharedHeap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+using Heap = alg::SharedHeap<uint64_t>;
+
+static void wait_ok(pid_t pid) {
+    int status;
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+static void check_sorted(Heap &heap) {
+    uint64_t prev = 0, x;
+    while (heap.try_pop(x)) {
+        CHECK(x >= prev);
+        prev = x;
+    }
+}
+
+int main() {
+    std::string name = "/alg_shared_heap_test_" + std::to_string(getpid());
+    Heap::remove(name);
+
+    // 4 processes push 5000 elements each, then pop all of them
+    {
+        std::vector<pid_t> pids;
+        for (int p = 0; p < 4; p++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                Heap heap(name, 20000);
+                std::mt19937_64 rng(p);
+                for (int i = 0; i < 5000; i++)
+                    heap.push(rng() % 1000000);
+                _exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (pid_t pid : pids)
+            wait_ok(pid);
+        Heap heap(name, 20000);
+        CHECK(heap.size() == 20000);
+        check_sorted(heap);
+        Heap::remove(name);
+    }
+
+    // creator died after creating the segment, before and after sizing it
+    for (off_t size : {off_t(0), off_t(4096)}) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd < 0 || flock(fd, LOCK_EX) != 0 || ftruncate(fd, size) != 0)
+                _exit(1);
+            _exit(0);
+        }
+        wait_ok(pid);
+        Heap heap(name, 100);
+        CHECK(heap.capacity() == 100 && heap.size() == 0);
+        heap.push(7);
+        CHECK(heap.pop() == 7);
+        Heap::remove(name);
+    }
+
+    // processes killed at random points while holding the lock
+    std::mt19937_64 rng(1);
+    for (int kill = 0; kill < 20; kill++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            Heap heap(name, 100000);
+            std::mt19937_64 r(kill);
+            uint64_t batch[64];
+            for (;;) {
+                for (auto &b : batch)
+                    b = r() % 1000000;
+                heap.push_batch(batch, 64);
+                heap.pop_batch(batch, 32);
+                if (heap.size() > 90000)
+                    heap.pop_batch(batch, 64);
+            }
+        }
+        usleep(useconds_t(rng() % 20000));
+        ::kill(pid, SIGKILL);
+        int status;
+        CHECK(waitpid(pid, &status, 0) == pid);
+    }
+    {
+        Heap heap(name, 100000);
+        check_sorted(heap);
+        Heap::remove(name);
+    }
+
+    std::printf("shared_heap ok\n");
+    return 0;
+}
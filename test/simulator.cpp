@@ -0,0 +1,121 @@
+// Simulator: same-time bursts run as one batch, in scheduling order; a
+// throwing action doesn't drop the rest of its batch, an action can
+// cancel a later event of its batch
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include "Simulator.hpp"
+#include "Bheap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+template <template <typename...> class Queue>
+void burst(size_t n, unsigned threads) {
+    alg::Simulator<Queue> sim;
+    sim.set_threads(threads);
+    std::vector<size_t> order;
+    std::vector<size_t> per_entity(8, 0);
+    std::vector<size_t> last(8, 0);
+    std::vector<char> bad(8, 0);
+    for (size_t i = 0; i < n; i++) {
+        if (threads > 1) {
+            // events of one entity keep their order
+            uint64_t e = i % 8;
+            sim.schedule(5.0, [&, i, e](alg::Simulator<Queue> &) {
+                if (per_entity[e]++ > 0 && last[e] >= i)
+                    bad[e] = 1;
+                last[e] = i;
+            }, e);
+        } else {
+            sim.schedule(5.0, [&, i](alg::Simulator<Queue> &) { order.push_back(i); });
+        }
+    }
+    // a later event must stay out of the batch
+    bool later = false;
+    sim.schedule(6.0, [&](alg::Simulator<Queue> &) { later = true; });
+    CHECK(sim.size() == n + 1);
+    CHECK(sim.step() == n);
+    CHECK(sim.now() == 5.0);
+    CHECK(!later);
+    for (char b : bad)
+        CHECK(!b);
+    if (threads > 1) {
+        size_t total = 0;
+        for (size_t c : per_entity)
+            total += c;
+        CHECK(total == n);
+    } else {
+        CHECK(order.size() == n);
+        for (size_t i = 0; i < n; i++)
+            CHECK(order[i] == i);
+    }
+    CHECK(sim.step() == 1);
+    CHECK(later && sim.size() == 0);
+}
+
+template <template <typename...> class Queue>
+void throwing(unsigned threads) {
+    using Sim = alg::Simulator<Queue>;
+    Sim sim;
+    sim.set_threads(threads);
+    std::vector<int> ran(10, 0);
+    for (int i = 0; i < 10; i++) {
+        sim.schedule(1.0, [&, i](Sim &) {
+            ran[size_t(i)]++;
+            if (i == 2 || i == 7)
+                throw std::runtime_error("action failed");
+        }, uint64_t(i));
+    }
+    bool later = false;
+    sim.schedule(2.0, [&](Sim &) { later = true; });
+    bool thrown = false;
+    try {
+        sim.step();
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    for (int r : ran)
+        CHECK(r == 1);
+    CHECK(sim.size() == 1 && !later);
+    CHECK(sim.step() == 1 && later && sim.size() == 0);
+}
+
+template <template <typename...> class Queue>
+void cancel_in_batch() {
+    using Sim = alg::Simulator<Queue>;
+    Sim sim;
+    std::vector<int> ran(5, 0);
+    std::vector<typename Sim::Handle> h(5);
+    bool cancelled = false, again = true;
+    for (int i = 0; i < 5; i++) {
+        h[size_t(i)] = sim.schedule(1.0, [&, i](Sim &s) {
+            ran[size_t(i)]++;
+            if (i == 1) {
+                cancelled = s.cancel(h[3]);
+                again = s.cancel(h[3]);
+                // an event that already ran can't be cancelled
+                CHECK(!s.cancel(h[0]));
+            }
+        });
+    }
+    CHECK(sim.size() == 5);
+    CHECK(sim.step() == 4);
+    CHECK(cancelled && !again);
+    CHECK(ran[0] == 1 && ran[1] == 1 && ran[2] == 1 && ran[3] == 0 && ran[4] == 1);
+    CHECK(sim.size() == 0 && sim.step() == 0);
+}
+
+int main() {
+    burst<alg::CalendarQueue>(200000, 1);
+    burst<alg::CalendarQueue>(200000, 4);
+    burst<alg::Bheap>(20000, 1);
+    throwing<alg::CalendarQueue>(1);
+    throwing<alg::CalendarQueue>(4);
+    throwing<alg::Bheap>(1);
+    cancel_in_batch<alg::CalendarQueue>();
+    cancel_in_batch<alg::Bheap>();
+    std::printf("simulator ok\n");
+    return 0;
+}
@@ -0,0 +1,128 @@
+// SoftHeap: corruption stays within eps * N, keys without a default
+// constructor; soft_select matches std::nth_element, also on an input
+// built against its median-of-3 pivots; soft_sort with tiny eps sorts
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "SoftHeap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+struct Key {
+    uint64_t v;
+    explicit Key(uint64_t x) : v(x) {}
+    bool operator < (const Key &r) const {
+        return v < r.v;
+    }
+};
+
+// McIlroy's adversary: values are decided ("frozen") only when compared,
+// always so that the candidate pivot is small
+struct Adversary {
+    std::vector<int> *val;
+    int *nsolid;
+    int *candidate;
+    int gas;
+    bool operator () (int x, int y) const {
+        std::vector<int> &v = *val;
+        if (v[size_t(x)] == gas && v[size_t(y)] == gas)
+            v[size_t(x == *candidate ? x : y)] = (*nsolid)++;
+        if (v[size_t(x)] == gas)
+            *candidate = x;
+        else if (v[size_t(y)] == gas)
+            *candidate = y;
+        return v[size_t(x)] < v[size_t(y)];
+    }
+};
+
+struct Counting {
+    size_t *count;
+    bool operator () (int a, int b) const {
+        ++*count;
+        return a < b;
+    }
+};
+
+int main() {
+    std::mt19937_64 rng(1);
+
+    // after k pops the largest popped key has at most k + eps * N smaller
+    // keys: only corrupted elements can be passed over
+    for (double eps : {0.5, 1.0 / 3, 0.1, 0.01}) {
+        alg::SoftHeap<Key> heap(eps);
+        const size_t n = 100000;
+        std::vector<uint64_t> sorted;
+        for (size_t i = 0; i < n; i++) {
+            sorted.push_back(rng() % 1000000);
+            heap.insert(Key(sorted.back()));
+        }
+        std::sort(sorted.begin(), sorted.end());
+        uint64_t max = 0;
+        Key prev(0);
+        for (size_t k = 1; !heap.empty(); k++) {
+            Key ckey(0);
+            Key x = heap.pop(ckey);
+            CHECK(!(ckey < x) && !(ckey < prev));
+            prev = ckey;
+            max = std::max(max, x.v);
+            size_t smaller = size_t(std::lower_bound(sorted.begin(), sorted.end(), max) - sorted.begin());
+            CHECK(smaller < k + size_t(eps * double(n)));
+        }
+        heap.insert(Key(3));
+        CHECK(heap.pop().v == 3);
+    }
+
+    // soft_select against nth_element on random, sorted and few distinct keys
+    for (int t = 0; t < 200; t++) {
+        size_t n = rng() % 5000 + 1;
+        std::vector<uint64_t> a(n);
+        for (auto &x : a)
+            x = t % 3 == 0 ? rng() % 4 : rng();
+        if (t % 5 == 0)
+            std::sort(a.begin(), a.end());
+        std::vector<uint64_t> b = a;
+        size_t k = rng() % n;
+        alg::soft_select(a.begin(), a.begin() + long(k), a.end());
+        std::nth_element(b.begin(), b.begin() + long(k), b.end());
+        CHECK(a[k] == b[k]);
+        for (size_t i = 0; i < n; i++)
+            CHECK(i < k ? a[i] <= a[k] : a[i] >= a[k]);
+    }
+
+    // median-of-3 killer: without the soft heap pivots this is quadratic
+    {
+        const int n = 20000;
+        std::vector<int> val(n, n), ids(n);
+        int nsolid = 0, candidate = 0;
+        for (int i = 0; i < n; i++)
+            ids[size_t(i)] = i;
+        alg::soft_select(ids.begin(), ids.begin() + n / 2, ids.end(),
+                         Adversary{&val, &nsolid, &candidate, n});
+        std::vector<int> a = val, b = val;
+        size_t count = 0;
+        alg::soft_select(a.begin(), a.begin() + n / 2, a.end(), Counting{&count});
+        std::nth_element(b.begin(), b.begin() + n / 2, b.end());
+        CHECK(a[n / 2] == b[n / 2]);
+        CHECK(count < size_t(100) * n);
+    }
+
+    // eps below 1/N sorts exactly, large eps keeps every element
+    {
+        std::vector<uint64_t> a(3000);
+        for (auto &x : a)
+            x = rng() % 1000;
+        std::vector<uint64_t> b = a;
+        alg::soft_sort(a.begin(), a.end(), 1.0 / 4000);
+        std::sort(b.begin(), b.end());
+        CHECK(a == b);
+        alg::soft_sort(a.begin(), a.end(), 0.5);
+        std::sort(a.begin(), a.end());
+        CHECK(a == b);
+    }
+
+    std::printf("soft_heap ok\n");
+    return 0;
+}
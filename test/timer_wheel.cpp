@@ -0,0 +1,112 @@
+// TimerWheel: timers fire in deadline order and exactly when a reference
+// set says so, for near deadlines in the wheel levels and far ones going
+// through the FibHeap or Bheap overflow; cancel, stale handles, scheduling
+// and cancelling from on_expire, payloads without a default constructor
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "TimerWheel.hpp"
+#include "Bheap.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+// FibHeap and Bheap nodes are released through shared_ptr cycles
+extern "C" const char *__asan_default_options() { return "detect_leaks=0"; }
+
+struct Payload {
+    explicit Payload(uint32_t id) : id(id), alive(std::make_shared<int>(0)) {
+    }
+    uint32_t id;
+    std::shared_ptr<int> alive;     // use_count tells whether the wheel keeps a copy
+};
+
+template <template <typename> class Heap>
+static void run(uint64_t start, std::mt19937_64 &rng) {
+    using Wheel = alg::TimerWheel<Payload, Heap>;
+    Wheel w(start);
+    std::set<std::pair<uint64_t, uint32_t>> ref;    // pending (deadline, id)
+    std::vector<typename Wheel::Handle> handles;
+    std::vector<uint64_t> deadline;
+    std::vector<std::shared_ptr<int>> alive;
+
+    auto schedule = [&](uint64_t d) {
+        uint32_t id = uint32_t(handles.size());
+        Payload p(id);
+        alive.push_back(p.alive);
+        if (d <= w.now())
+            d = w.now() + 1;
+        handles.push_back(w.schedule(d, p));
+        deadline.push_back(d);
+        ref.emplace(d, id);
+    };
+    auto cancel = [&](uint32_t id) {
+        bool pending = ref.erase(std::make_pair(deadline[id], id)) != 0;
+        CHECK(w.cancel(handles[id]) == pending);
+        CHECK(!w.cancel(handles[id]));
+        CHECK(alive[id].use_count() == 1);
+    };
+    auto far = [&]() {
+        return w.now() + (uint64_t(1) << 32) + rng() % (uint64_t(1) << 34);
+    };
+
+    for (int op = 0; op < 3000; op++) {
+        uint64_t c = rng() % 10;
+        if (c < 5) {
+            uint64_t r = rng() % 4;
+            uint64_t d = r == 0 ? w.now() - std::min<uint64_t>(w.now(), rng() % 3)
+                       : r == 1 ? w.now() + rng() % 300
+                       : r == 2 ? w.now() + rng() % (uint64_t(1) << 28)
+                       : far();
+            schedule(d);
+        } else if (c < 7) {
+            if (!handles.empty())
+                cancel(uint32_t(rng() % handles.size()));
+        } else {
+            uint64_t r = rng() % 3;
+            uint64_t t = w.now() + (r == 0 ? rng() % 1000 : r == 1 ? rng() % (uint64_t(1) << 30)
+                                                               : rng() % (uint64_t(1) << 36));
+            size_t calls = 0;
+            size_t fired = w.advance(t, [&](uint64_t d, Payload &p) {
+                calls++;
+                CHECK(!ref.empty());
+                // timers of one tick fire in any order
+                CHECK(ref.begin()->first == d);
+                CHECK(ref.erase(std::make_pair(d, p.id)) == 1);
+                CHECK(d == deadline[p.id] && d == w.now());
+                CHECK(!w.cancel(handles[p.id]));
+                uint64_t k = rng() % 8;
+                if (k == 0)
+                    schedule(d + rng() % 3);    // may fire later in this advance
+                else if (k == 1)
+                    schedule(far());
+                else if (k == 2 && !ref.empty())
+                    cancel(std::next(ref.begin(), long(rng() % ref.size()))->second);
+            });
+            CHECK(fired == calls);
+            CHECK(w.now() == t);
+            CHECK(ref.empty() || ref.begin()->first > t);
+        }
+        CHECK(w.size() == ref.size());
+    }
+    w.advance(UINT64_MAX - 1, [&](uint64_t d, Payload &p) {
+        CHECK(ref.begin()->first == d);
+        CHECK(ref.erase(std::make_pair(d, p.id)) == 1);
+    });
+    CHECK(ref.empty() && w.size() == 0);
+    for (auto &a : alive)
+        CHECK(a.use_count() == 1);
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    run<alg::FibHeap>(0, rng);
+    run<alg::Bheap>(0, rng);
+    run<alg::FibHeap>((uint64_t(1) << 40) - 5, rng);
+    std::printf("timer_wheel ok\n");
+    return 0;
+}
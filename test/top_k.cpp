@@ -0,0 +1,83 @@
+// TopK: push, push_batch and merge of per-thread selectors keep the same
+// elements as sorting everything and taking the first K
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "TopK.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+template <typename T, typename Compare>
+static std::vector<T> expect(std::vector<T> v, size_t k, Compare comp) {
+    std::sort(v.begin(), v.end(), [&](const T &a, const T &b) { return comp(b, a); });
+    v.resize(std::min(k, v.size()));
+    return v;
+}
+
+template <typename T, typename Compare>
+static void run(std::mt19937_64 &rng, T range, Compare comp) {
+    for (int t = 0; t < 200; t++) {
+        size_t n = rng() % 5000;
+        size_t k = rng() % 3 == 0 ? rng() % 4 + 1 : rng() % 300 + 1;
+        std::vector<T> v(n);
+        for (auto &x : v)
+            x = T(rng() % uint64_t(range));
+        // ascending input makes every element enter
+        if (t % 7 == 0)
+            std::sort(v.begin(), v.end(), comp);
+        std::vector<T> want = expect(v, k, comp);
+
+        alg::TopK<T, Compare> one(k, comp), batch(k, comp), iter(k, comp);
+        size_t kept = 0;
+        for (const T &x : v)
+            kept += one.push(x);
+        CHECK(kept >= want.size());
+        batch.push_batch(v.data(), v.size());
+        iter.push_batch(v.begin(), v.end());
+        CHECK(one.sorted() == want && batch.sorted() == want && iter.sorted() == want);
+        CHECK(one.size() == want.size());
+        if (!want.empty())
+            CHECK(one.threshold() == want.back());
+
+        // split over 4 selectors at uneven points, merge them
+        std::vector<alg::TopK<T, Compare>> parts(4, alg::TopK<T, Compare>(k, comp));
+        for (size_t i = 0; i < n; i++)
+            parts[(i * 7 / 3) % 4].push(v[i]);
+        for (size_t p = 1; p < 4; p++)
+            parts[0].merge(parts[p]);
+        CHECK(parts[0].sorted() == want);
+
+        one.clear();
+        CHECK(one.size() == 0 && one.capacity() == k);
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    run<int>(rng, 1000, std::less<int>());
+    run<int>(rng, 20, std::greater<int>());
+    run<float>(rng, 1e6f, std::less<float>());
+    run<uint64_t>(rng, 1ull << 40, std::less<uint64_t>());
+    bool thrown = false;
+    try {
+        alg::TopK<int> bad(0);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    alg::TopK<int> empty(3);
+    thrown = false;
+    try {
+        empty.threshold();
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    std::printf("top_k ok\n");
+    return 0;
+}
@@ -0,0 +1,172 @@
+// WindowTopK: top() matches brute-force sums of the events in the window,
+// with late events, negative deltas and ties ranked by the time an item
+// entered the window; merge of shards that partition keys; keys without
+// a default constructor
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+#include "WindowTopK.hpp"
+
+#define CHECK(c) do { if (!(c)) { std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); std::exit(1); } } while (0)
+
+struct Id {
+    explicit Id(int v) : v(v) {
+    }
+    int v;
+    bool operator == (const Id &r) const {
+        return v == r.v;
+    }
+};
+struct IdHash {
+    size_t operator () (const Id &d) const {
+        return std::hash<int>()(d.v);
+    }
+};
+
+using Top = alg::WindowTopK<Id, long, IdHash>;
+
+struct Ref {
+    struct Ev {
+        uint64_t time;
+        int key;
+        long delta;
+    };
+    struct Item {
+        long score = 0;
+        uint32_t events = 0;
+        uint64_t seq = 0;
+    };
+    uint64_t window;
+    uint64_t now = 0;
+    uint64_t seq = 0;
+    std::vector<Ev> evs;
+    std::map<int, Item> items;
+
+    size_t expire(uint64_t t) {
+        now = std::max(now, t);
+        if (now < window)
+            return 0;
+        size_t dropped = 0;
+        for (size_t i = 0; i < evs.size();) {
+            if (evs[i].time <= now - window) {
+                Item &it = items[evs[i].key];
+                it.score -= evs[i].delta;
+                if (--it.events == 0)
+                    items.erase(evs[i].key);
+                evs[i] = evs.back();
+                evs.pop_back();
+                dropped++;
+            } else {
+                i++;
+            }
+        }
+        return dropped;
+    }
+    bool add(int key, long delta, uint64_t t) {
+        expire(t);
+        if (now >= window && t <= now - window)
+            return false;
+        Item &it = items[key];
+        if (it.events++ == 0)
+            it.seq = seq++;
+        it.score += delta;
+        evs.push_back(Ev{t, key, delta});
+        return true;
+    }
+    // (key, score) best first, ties go to the smaller seq
+    std::vector<std::pair<int, long>> top(size_t k) const {
+        std::vector<std::pair<const int, Item> const *> v;
+        for (auto &kv : items)
+            v.push_back(&kv);
+        std::sort(v.begin(), v.end(), [](auto a, auto b) {
+            return a->second.score > b->second.score ||
+                   (a->second.score == b->second.score && a->second.seq < b->second.seq);
+        });
+        std::vector<std::pair<int, long>> res;
+        for (size_t i = 0; i < v.size() && i < k; i++)
+            res.emplace_back(v[i]->first, v[i]->second.score);
+        return res;
+    }
+};
+
+static void check_top(const Top &t, const Ref &ref, size_t k) {
+    std::vector<Top::Item> out;
+    t.top(out);
+    auto want = ref.top(k);
+    CHECK(out.size() == want.size());
+    for (size_t i = 0; i < out.size(); i++) {
+        CHECK(out[i].key.v == want[i].first);
+        CHECK(out[i].score == want[i].second);
+    }
+    CHECK(t.size() == ref.items.size());
+    CHECK(t.events() == ref.evs.size());
+}
+
+static void run(uint64_t window, size_t k, int keys, std::mt19937_64 &rng) {
+    Top t(window, k);
+    Ref ref{window};
+    uint64_t now = 0;
+    for (int op = 0; op < 20000; op++) {
+        uint64_t c = rng() % 100;
+        if (c < 3) {
+            now += rng() % (2 * window);
+            CHECK(t.expire(now) == ref.expire(now));
+        } else {
+            uint64_t time;
+            if (c < 20)
+                time = now - std::min<uint64_t>(now, rng() % (window + 3));  // late, maybe too late
+            else
+                time = now += rng() % 3;
+            int key = int(rng() % uint64_t(keys));
+            long delta = long(rng() % 16) - 5;
+            CHECK(t.add(Id(key), delta, time) == ref.add(key, delta, time));
+            CHECK(t.now() == ref.now);
+        }
+        check_top(t, ref, k);
+        int key = int(rng() % uint64_t(keys));
+        auto it = ref.items.find(key);
+        CHECK(t.contains(Id(key)) == (it != ref.items.end()));
+        CHECK(t.score(Id(key)) == (it == ref.items.end() ? 0 : it->second.score));
+    }
+}
+
+static void shards(std::mt19937_64 &rng) {
+    const size_t k = 5;
+    Top a(50, k), b(50, k), all(50, k);
+    uint64_t now = 0;
+    for (int i = 0; i < 5000; i++) {
+        now += rng() % 2;
+        int key = int(rng() % 40);
+        long delta = long(rng() % 100);
+        (key % 2 ? a : b).add(Id(key), delta, now);
+        all.add(Id(key), delta, now);
+        if (i % 100 == 0) {
+            a.expire(now);
+            b.expire(now);
+            std::vector<Top::Item> m, want;
+            Top::merge({&a, &b}, k, m);
+            all.top(want);
+            CHECK(m.size() == want.size());
+            // equal scores may come in any order from merge
+            for (size_t j = 0; j < m.size(); j++) {
+                CHECK(m[j].score == want[j].score);
+                CHECK(all.score(m[j].key) == m[j].score);
+            }
+        }
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    run(10, 1, 5, rng);
+    run(10, 3, 20, rng);
+    run(100, 8, 30, rng);
+    run(1000, 16, 200, rng);
+    shards(rng);
+    std::printf("window_top_k ok\n");
+    return 0;
+}